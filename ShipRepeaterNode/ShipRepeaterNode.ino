@@ -12,6 +12,7 @@ Adafruit_NeoPixel pixel(1, NEOPIXEL_PIN, NEO_GRB + NEO_KHZ800);
 SdFat sd;
 NodeConfig config;
 SemaphoreHandle_t sdCardMutex;
+SemaphoreHandle_t sdBusMutex;
 
 // Global state machine control
 bool isOperationalMode = false;
@@ -26,6 +27,7 @@ void setup() {
   setupStatusLed();
   pinMode(BOOT_BUTTON_PIN, INPUT_PULLUP);
   sdCardMutex = xSemaphoreCreateMutex();
+  sdBusMutex = xSemaphoreCreateRecursiveMutex();
 
   delay(50);  // Debounce for boot button
   bool forceConfigMode = (digitalRead(BOOT_BUTTON_PIN) == LOW);
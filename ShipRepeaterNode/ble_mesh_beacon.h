@@ -2,16 +2,112 @@
 #define BLE_MESH_BEACON_H
 
 #include <Arduino.h>
+#include "config.h"
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLEAdvertising.h>
 #include <BLEScan.h>
 #include <BLEAdvertisedDevice.h>
+#include <esp_bt.h>
 
 // BLE Service UUID for mesh node identification
 #define BLE_MESH_SERVICE_UUID "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 
+// Manufacturer data του beacon (στο scan response), ακολουθεί το AP SSID
+// χωρίς '\0'. Τα beacons πριν το versioning (v0) έχουν μόνο [role, SSID...]
+// και τα διαβάζει ακόμα ο scanner (role 0/1 != MESH_BEACON_MAGIC).
+#define MESH_BEACON_MAGIC    0xA5
+#define MESH_BEACON_VERSION  1
+#define MESH_BEACON_MAX_SSID (31 - 2 - (int)sizeof(MeshBeaconInfo))  // 31 bytes scan response
+
+struct __attribute__((packed)) MeshBeaconInfo {
+    uint8_t magic = MESH_BEACON_MAGIC;
+    uint8_t version = MESH_BEACON_VERSION;
+    uint8_t role = 0;         // 0 = Repeater, 1 = Root
+    uint8_t hops = 1;         // hops ως τον root (0 = root)
+    uint8_t stations = 0;     // συνδεδεμένοι clients στο AP
+    uint8_t freeSlots = 0;    // θέσεις που μένουν στο AP (MESH_AP_MAX_STATIONS - stations)
+    int8_t  uplinkRssi = 0;   // dBm προς τον δικό του parent, 0 = άγνωστο
+    uint8_t flags = 0;
+};
+
+// Ώρα του node στο advertisement (manufacturer data δίπλα στο service UUID),
+// ώστε ένας collector χωρίς ρολόι να κάνει sync από το BLE scan, χωρίς WiFi
+// και /time. Ανανεώνεται κάθε MESH_TIME_REFRESH_MS όσο η ώρα είναι έγκυρη.
+#define MESH_TIME_MAGIC      0xA6
+#define MESH_TIME_UNKNOWN    0xFF  // accuracy: ο node δεν έχει έγκυρη ώρα
+
+struct __attribute__((packed)) MeshTimeInfo {
+    uint8_t magic = MESH_TIME_MAGIC;
+    uint32_t epoch = 0;       // little-endian, Unix seconds
+    uint8_t accuracy = MESH_TIME_UNKNOWN;  // ± seconds (μαζί με την καθυστέρηση refresh)
+};
+
+// BLE lifecycle. Με BLE_KEEP_RESIDENT ο controller ανεβαίνει μία φορά ανά
+// boot μόνο σε BLE mode (η μνήμη του Classic BT ελευθερώνεται στο boot) και
+// μένει idle ανάμεσα στα scans/advertising: χωρίς BLEDevice::deinit(true),
+// που κοστίζει χρόνο και δεν αφήνει δεύτερο init στο ίδιο boot.
+// Χωρίς BLE_KEEP_RESIDENT: init/deinit(true) σε κάθε χρήση, όπως πριν.
+static inline bool& ble_classicReleased() {
+    static bool released = false;
+    return released;
+}
+
+// Μία φορά στο boot, πριν από κάθε BLEDevice::init
+static inline void ble_releaseClassicMemory() {
+#if BLE_KEEP_RESIDENT
+    if (ble_classicReleased()) return;
+    if (esp_bt_controller_get_status() != ESP_BT_CONTROLLER_STATUS_IDLE) {
+        Serial.println("[BLE] Controller already started, Classic BT memory kept");
+        return;
+    }
+    uint32_t freeBefore = ESP.getFreeHeap();
+    uint32_t blockBefore = ESP.getMaxAllocHeap();
+    esp_err_t err = esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
+    if (err != ESP_OK) {
+        Serial.printf("[BLE] Classic BT memory release failed (%d)\n", (int)err);
+        return;
+    }
+    ble_classicReleased() = true;
+    Serial.printf("[BLE] Classic BT memory released: free heap %lu -> %lu, largest block %lu -> %lu\n",
+                  (unsigned long)freeBefore, (unsigned long)ESP.getFreeHeap(),
+                  (unsigned long)blockBefore, (unsigned long)ESP.getMaxAllocHeap());
+#endif
+}
+
+// Controller + Bluedroid. Αν είναι ήδη πάνω (resident), δεν κάνει τίποτα.
+static inline bool ble_begin(const char* deviceName) {
+    if (BLEDevice::getInitialized()) return true;
+    uint32_t freeBefore = ESP.getFreeHeap();
+    // Μετά το release του Classic BT, ο controller ανεβαίνει μόνο σε BLE
+    // mode (το btStart του BLEDevice::init ζητάει BTDM)
+    if (ble_classicReleased() && !btStartMode(BT_MODE_BLE)) {
+        Serial.println("[BLE] Controller start (BLE mode) failed");
+        return false;
+    }
+    try {
+        BLEDevice::init(deviceName);
+    } catch (...) {
+        return false;
+    }
+    Serial.printf("[BLE] Controller up: free heap %lu -> %lu\n",
+                  (unsigned long)freeBefore, (unsigned long)ESP.getFreeHeap());
+    return true;
+}
+
+static inline void ble_end() {
+#if !BLE_KEEP_RESIDENT
+    BLEDevice::deinit(true);
+#endif
+}
+
+// Πριν το deep sleep ο controller πρέπει να είναι disabled. Η μνήμη δεν
+// ελευθερώνεται (deinit(false)): το επόμενο boot ξεκινάει από την αρχή.
+static inline void ble_shutdown() {
+    if (BLEDevice::getInitialized()) BLEDevice::deinit(false);
+}
+
 // BLE Beacon Manager for Repeaters/Root
 // Advertises the node's presence so children can discover and wake it up
 class BLEBeaconManager {
@@ -20,15 +116,13 @@ public:
         Serial.println("[BLE-BEACON] Initializing BLE Beacon...");
         
         // Initialize BLE
-        try {
-            BLEDevice::init(nodeName.c_str());
-        } catch (...) {
+        if (!ble_begin(nodeName.c_str())) {
             Serial.println("[BLE-BEACON] ERROR: Failed to initialize BLE");
             return;
         }
         
         // Create BLE Server (needed for advertising)
-        pServer = BLEDevice::createServer();
+        if (!pServer) pServer = BLEDevice::createServer();  // resident: ίδιος server
         if (!pServer) {
             Serial.println("[BLE-BEACON] ERROR: Failed to create BLE server");
             return;
@@ -49,17 +143,20 @@ public:
         pAdvertising->setMinPreferred(0x06);  // Min connection interval
         pAdvertising->setMaxPreferred(0x12);  // Max connection interval
         
-        // Add manufacturer data with node role and AP SSID
-        // Format: [role_byte, apSSID_bytes...]
-        // We advertise AP SSID because that's what's needed for WiFi connection
-        BLEAdvertisementData advData;
-        std::string mfgData;
-        mfgData.push_back(nodeRole); // 0=Repeater, 1=Root
-        mfgData.append(apSSID.c_str());  // Use AP SSID instead of node name
-        advData.setManufacturerData(mfgData);
-        advData.setCompleteServices(BLEUUID(BLE_MESH_SERVICE_UUID));
-        pAdvertising->setAdvertisementData(advData);
+        // Advertisement: service UUID (18 bytes) + MeshTimeInfo (8 bytes).
+        // Το MeshBeaconInfo + AP SSID πάνε στο scan response, ώστε να χωράνε
+        // στα 31 bytes (οι scanners κάνουν active scan).
+        timeInfo = MeshTimeInfo();
+        applyTime();
+
+        ssid = apSSID;
+        info = MeshBeaconInfo();
+        info.role = nodeRole;
+        info.hops = nodeRole == 1 ? 0 : 1;
+        info.freeSlots = MESH_AP_MAX_STATIONS;  // μέχρι το πρώτο updateInfo
+        applyInfo();
         
+        advIntervalMs = ADV_INTERVAL_DEFAULT;
         isInitialized = true;
         Serial.printf("[BLE-BEACON] BLE Beacon initialized (advertising AP SSID: %s)\n", apSSID.c_str());
     }
@@ -87,7 +184,7 @@ public:
     void stop() {
         stopAdvertising();
         if (isInitialized) {
-            BLEDevice::deinit(true);
+            ble_end();
             isInitialized = false;
             Serial.println("[BLE-BEACON] BLE Beacon stopped");
         }
@@ -97,15 +194,137 @@ public:
         return isAdvertising;
     }
 
+    // begin() έγινε (το advertising μπορεί να είναι σε παύση από τον scheduler)
+    bool isReady() const {
+        return isInitialized;
+    }
+
+    // Interval advertising σε ms, 0 = παύση. Αλλαγή => stop/start, αφού το
+    // controller δεν αλλάζει interval εν κινήσει.
+    void setAdvInterval(uint16_t ms) {
+        if (!isInitialized || ms == advIntervalMs) return;
+        advIntervalMs = ms;
+        if (ms == 0) {
+            stopAdvertising();
+            return;
+        }
+        // Μονάδες 0.625 ms, όριο BLE 20 ms .. 10.24 s
+        uint32_t units = constrain((uint32_t)ms * 8 / 5, (uint32_t)0x20, (uint32_t)0x4000);
+        pAdvertising->setMinInterval((uint16_t)units);
+        pAdvertising->setMaxInterval((uint16_t)min<uint32_t>(units + units / 8, 0x4000));
+        if (isAdvertising) {
+            pAdvertising->stop();
+            BLEDevice::startAdvertising();
+        } else {
+            startAdvertising();
+        }
+        Serial.printf("[BLE-BEACON] Advertising interval %u ms\n", (unsigned)ms);
+    }
+
+    // Νέα hops/stations/uplink στο scan response, μόνο αν άλλαξαν
+    void updateInfo(const MeshBeaconInfo& next) {
+        if (!isInitialized || memcmp(&next, &info, sizeof(info)) == 0) return;
+        info = next;
+        applyInfo();
+    }
+    const MeshBeaconInfo& currentInfo() const { return info; }
+
+    // Ώρα στο advertisement. accuracy = MESH_TIME_UNKNOWN τη βγάζει.
+    void updateTime(uint32_t epoch, uint8_t accuracy) {
+        if (!isInitialized) return;
+        timeInfo.epoch = accuracy == MESH_TIME_UNKNOWN ? 0 : epoch;
+        timeInfo.accuracy = accuracy;
+        applyTime();
+    }
+
 private:
+    void applyTime() {
+        BLEAdvertisementData advData;
+        advData.setCompleteServices(BLEUUID(BLE_MESH_SERVICE_UUID));
+        if (timeInfo.accuracy != MESH_TIME_UNKNOWN) {
+            advData.setManufacturerData(std::string((const char*)&timeInfo, sizeof(timeInfo)));
+        }
+        pAdvertising->setAdvertisementData(advData);
+    }
+
+    void applyInfo() {
+        std::string mfgData((const char*)&info, sizeof(info));
+        mfgData.append(ssid.c_str(), min((int)ssid.length(), MESH_BEACON_MAX_SSID));
+        BLEAdvertisementData scanData;
+        scanData.setManufacturerData(mfgData);
+        pAdvertising->setScanResponseData(scanData);
+    }
+
+    static const uint16_t ADV_INTERVAL_DEFAULT = 0xFFFF;  // default του BLE lib (20-40 ms)
+
+    String ssid;
+    MeshBeaconInfo info;
+    MeshTimeInfo timeInfo;
+    uint16_t advIntervalMs = ADV_INTERVAL_DEFAULT;
     BLEServer* pServer = nullptr;
     BLEAdvertising* pAdvertising = nullptr;
     bool isInitialized = false;
     bool isAdvertising = false;
 };
 
+// Duty cycle του advertising στον repeater. Οι collectors ψάχνουν parent
+// γύρω από τα όρια του uplink (κάθε meshIntervalMin, βλ. decideAndGoToSleep)
+// και όπου έχουν φανεί να συνδέονται, οπότε εκεί advertising κάθε
+// BLE_ADV_FAST_MS και ενδιάμεσα κάθε BLE_ADV_SLOW_MS (0 = παύση).
+// Χωρίς έγκυρη ώρα δεν ξέρουμε τα όρια: πάντα fast.
+class BLEAdvScheduler {
+public:
+    // Νέος collector στο AP: η θέση του μέσα στο interval γίνεται fast window
+    void noteArrival(time_t now, uint32_t intervalS) {
+        if (intervalS == 0) return;
+        uint32_t offset = (uint32_t)(now % intervalS);
+        if (inBoundaryWindow(offset, intervalS)) return;
+        for (uint8_t i = 0; i < arrivalCount; i++) {
+            if (distance(offset, arrivals[i], intervalS) <= BLE_ADV_ARRIVAL_MARGIN_S / 2) return;
+        }
+        arrivals[nextArrival] = offset;
+        nextArrival = (nextArrival + 1) % BLE_ADV_MAX_ARRIVALS;
+        if (arrivalCount < BLE_ADV_MAX_ARRIVALS) arrivalCount++;
+        Serial.printf("[BLE-ADV] Collector arrival at +%lu s of the %lu s uplink interval\n",
+                      (unsigned long)offset, (unsigned long)intervalS);
+    }
+
+    // Interval (ms) για τώρα, 0 = παύση
+    uint16_t intervalFor(time_t now, uint32_t intervalS) const {
+        if (now < 1700000000L || intervalS == 0) return BLE_ADV_FAST_MS;
+        uint32_t offset = (uint32_t)(now % intervalS);
+        if (inBoundaryWindow(offset, intervalS)) return BLE_ADV_FAST_MS;
+        for (uint8_t i = 0; i < arrivalCount; i++) {
+            if (distance(offset, arrivals[i], intervalS) <= BLE_ADV_ARRIVAL_MARGIN_S) return BLE_ADV_FAST_MS;
+        }
+        return BLE_ADV_SLOW_MS;
+    }
+
+private:
+    static bool inBoundaryWindow(uint32_t offset, uint32_t intervalS) {
+        return offset <= BLE_ADV_FAST_AFTER_S || intervalS - offset <= BLE_ADV_FAST_BEFORE_S;
+    }
+
+    // Απόσταση μέσα στο interval, κυκλικά
+    static uint32_t distance(uint32_t a, uint32_t b, uint32_t intervalS) {
+        uint32_t d = a > b ? a - b : b - a;
+        return min(d, intervalS - d);
+    }
+
+    uint32_t arrivals[BLE_ADV_MAX_ARRIVALS] = {0};
+    uint8_t arrivalCount = 0;
+    uint8_t nextArrival = 0;
+};
+
 // BLE Scanner for Collectors/Repeaters
-// Scans for parent nodes to discover and wake them up
+// Scans for parent nodes to discover and wake them up.
+// Τα advertisements έρχονται σε callback (BT task) και το payload
+// διαβάζεται in place. Ο parent επιλέγεται με το μικρότερο cost (RSSI, hops,
+// φορτίο AP, uplink από το MeshBeaconInfo), ώστε οι collectors να μοιράζονται
+// στους repeaters. Parent γίνεται μόνο node που έστειλε manufacturer data με
+// SSID· ένα advertisement μόνο με UUID/ώρα δεν αρκεί. Το scan σταματά μόλις φανεί idle parent (hops <= 1,
+// χωρίς stations) με RSSI >= BLE_PARENT_RSSI_STRONG ή BLE_SCAN_CONFIRM_MS
+// μετά τον πρώτο parent. Το scanDurationSeconds είναι μόνο το ανώτατο όριο.
 class BLEScannerManager {
 public:
     struct ScanResult {
@@ -115,13 +334,21 @@ public:
         uint8_t nodeRole = 0;
         int rssi = 0;
         String address;
+        uint32_t elapsedMs = 0;  // πόσο έμεινε ανοιχτό το radio
+        uint8_t hops = 1;
+        uint8_t stations = 0;
+        int cost = 0;
+        // Η πιο ακριβής ώρα που ακούστηκε (από οποιονδήποτε mesh node):
+        // epoch ισχύει τη στιγμή millis() == timeAtMillis
+        bool timeValid = false;
+        uint32_t epoch = 0;
+        uint8_t timeAccuracy = MESH_TIME_UNKNOWN;
+        uint32_t timeAtMillis = 0;
     };
 
     void begin(const String& scannerName = "MeshScanner") {
         Serial.println("[BLE-SCAN] Initializing BLE Scanner...");
-        try {
-            BLEDevice::init(scannerName.c_str());  // Use unique name for debugging
-        } catch (...) {
+        if (!ble_begin(scannerName.c_str())) {  // Use unique name for debugging
             Serial.println("[BLE-SCAN] ERROR: Failed to initialize BLE");
             return;
         }
@@ -132,6 +359,10 @@ public:
             return;
         }
         
+        callbacks.owner = this;
+        // Duplicates: το scan response (MeshBeaconInfo) μπορεί να έρθει σε
+        // ξεχωριστό report από το advertisement με το service UUID
+        pBLEScan->setAdvertisedDeviceCallbacks(&callbacks, true);
         pBLEScan->setActiveScan(true);
         pBLEScan->setInterval(100);
         pBLEScan->setWindow(99);
@@ -147,99 +378,286 @@ public:
             return result;
         }
 
-        Serial.printf("[BLE-SCAN] Starting scan for %d seconds...\n", scanDurationSeconds);
-        
-        BLEScanResults foundDevices = pBLEScan->start(scanDurationSeconds, false);
-        int count = foundDevices.getCount();
-        
-        Serial.printf("[BLE-SCAN] Found %d devices\n", count);
-        
-        // Find the strongest signal with our service UUID
-        int bestRSSI = -999;
-        int bestIndex = -1;
-        
-        for (int i = 0; i < count; i++) {
-            BLEAdvertisedDevice device = foundDevices.getDevice(i);
-            
-            // Check if device has our mesh service UUID
-            if (device.haveServiceUUID() && device.isAdvertisingService(BLEUUID(BLE_MESH_SERVICE_UUID))) {
-                int rssi = device.getRSSI();
-                
-                // Extract AP SSID from manufacturer data if available
-                String apSSID = String(device.getName().c_str());  // Default to BLE name
-                if (device.haveManufacturerData()) {
-                    std::string mfgData = device.getManufacturerData();
-                    if (mfgData.length() > 1) {
-                        // Extract AP SSID from manufacturer data (skip first byte which is role)
-                        apSSID = "";
-                        for (size_t j = 1; j < mfgData.length(); j++) {
-                            apSSID += (char)mfgData[j];
-                        }
-                    }
-                }
-                
-                Serial.printf("[BLE-SCAN] Found mesh node AP: %s, RSSI: %d\n", 
-                             apSSID.c_str(), rssi);
-                
-                if (rssi > bestRSSI) {
-                    bestRSSI = rssi;
-                    bestIndex = i;
-                }
-            }
+        Serial.printf("[BLE-SCAN] Starting scan (max %d s)...\n", scanDurationSeconds);
+
+        portENTER_CRITICAL(&candMux);
+        for (Candidate& k : cands) k = Candidate();
+        firstSeenMillis = 0;
+        strongSeen = false;
+        portEXIT_CRITICAL(&candMux);
+        scanDone() = false;
+
+        uint32_t t0 = millis();
+        uint32_t limitMs = (uint32_t)scanDurationSeconds * 1000UL;
+        pBLEScan->start(scanDurationSeconds, onScanComplete, false);
+        while (!scanDone() && millis() - t0 < limitMs) {
+            portENTER_CRITICAL(&candMux);
+            bool strong = strongSeen;
+            uint32_t first = firstSeenMillis;
+            portEXIT_CRITICAL(&candMux);
+            if (strong) break;
+            if (first && millis() - first >= BLE_SCAN_CONFIRM_MS) break;
+            delay(20);
         }
-        
-        if (bestIndex >= 0) {
-            BLEAdvertisedDevice bestDevice = foundDevices.getDevice(bestIndex);
+        pBLEScan->stop();
+        pBLEScan->clearResults();
+        result.elapsedMs = millis() - t0;
+
+        portENTER_CRITICAL(&candMux);
+        Candidate c;
+        Candidate clock;
+        for (const Candidate& k : cands) {
+            if (usable(k) && (!c.valid || k.cost < c.cost)) c = k;
+            if (k.valid && k.timeAccuracy < clock.timeAccuracy) clock = k;
+        }
+        portEXIT_CRITICAL(&candMux);
+
+        if (clock.timeAccuracy != MESH_TIME_UNKNOWN) {
+            result.timeValid = true;
+            result.epoch = clock.epoch;
+            result.timeAccuracy = clock.timeAccuracy;
+            result.timeAtMillis = clock.timeMillis;
+        }
+
+        if (c.valid) {
             result.found = true;
-            result.nodeName = String(bestDevice.getName().c_str());
-            result.rssi = bestRSSI;
-            result.address = String(bestDevice.getAddress().toString().c_str());
-            
-            // Extract role and AP SSID from manufacturer data
-            if (bestDevice.haveManufacturerData()) {
-                std::string mfgData = bestDevice.getManufacturerData();
-                if (mfgData.length() > 0) {
-                    result.nodeRole = mfgData[0];  // First byte is role
-                    
-                    // Extract AP SSID (rest of manufacturer data)
-                    if (mfgData.length() > 1) {
-                        result.apSSID = "";
-                        for (size_t i = 1; i < mfgData.length(); i++) {
-                            result.apSSID += (char)mfgData[i];
-                        }
-                    } else {
-                        // Fallback to BLE device name if no SSID in manufacturer data
-                        result.apSSID = result.nodeName;
-                    }
-                }
-            } else {
-                // No manufacturer data, use BLE name as fallback
-                result.apSSID = result.nodeName;
-            }
+            result.nodeRole = c.role;
+            result.rssi = c.rssi;
+            result.hops = c.hops;
+            result.stations = c.stations;
+            result.cost = c.cost;
+            result.nodeName = c.name;
+            result.apSSID = c.ssid;
+            char addr[18];
+            snprintf(addr, sizeof(addr), "%02x:%02x:%02x:%02x:%02x:%02x",
+                     c.addr[0], c.addr[1], c.addr[2], c.addr[3], c.addr[4], c.addr[5]);
+            result.address = addr;
             
             const char* roleStr = (result.nodeRole == 0) ? "Repeater" : "Root";
-            Serial.printf("[BLE-SCAN] Selected parent SSID: %s (Role: %s, RSSI: %d)\n", 
-                         result.apSSID.c_str(), roleStr, result.rssi);
+            Serial.printf("[BLE-SCAN] Selected parent SSID: %s (Role: %s, RSSI: %d, hops: %u, stations: %u, cost: %d) after %lu ms\n",
+                         result.apSSID.c_str(), roleStr, result.rssi, (unsigned)result.hops,
+                         (unsigned)result.stations, result.cost, (unsigned long)result.elapsedMs);
         } else {
-            Serial.println("[BLE-SCAN] No mesh nodes found");
+            Serial.printf("[BLE-SCAN] No mesh nodes found (%lu ms)\n", (unsigned long)result.elapsedMs);
         }
         
-        pBLEScan->clearResults();
         return result;
     }
 
     void stop() {
         if (isInitialized) {
             pBLEScan->stop();
-            BLEDevice::deinit(true);
+            pBLEScan->setAdvertisedDeviceCallbacks(nullptr);
+            pBLEScan->clearResults();
+            ble_end();  // resident: ο controller μένει idle για το επόμενο scan
             isInitialized = false;
             Serial.println("[BLE-SCAN] BLE Scanner stopped");
         }
     }
 
 private:
+    struct Candidate {
+        bool valid = false;
+        bool hasInfo = false;   // ήρθε manufacturer data (v1 ή legacy)
+        uint8_t version = 0;    // 0 = legacy [role, SSID]
+        uint8_t role = 0;
+        uint8_t hops = 1;
+        uint8_t stations = 0;
+        uint8_t freeSlots = 1;
+        int8_t uplinkRssi = 0;
+        uint32_t epoch = 0;
+        uint8_t timeAccuracy = MESH_TIME_UNKNOWN;
+        uint32_t timeMillis = 0;   // millis() όταν ήρθε το MeshTimeInfo
+        int rssi = -999;
+        int cost = 0;
+        uint8_t addr[6] = {0};
+        char ssid[33] = "";
+        char name[32] = "";
+    };
+
+    // Το BLE name δεν είναι SSID: χωρίς manufacturer data δεν ξέρουμε πού να συνδεθούμε
+    static bool usable(const Candidate& c) {
+        return c.valid && c.hasInfo && c.ssid[0];
+    }
+
+    // Κάθε report φέρνει μέρος του node (advertisement ή scan response)
+    static void merge(Candidate& into, const Candidate& from) {
+        into.rssi = from.rssi;
+        if (from.name[0]) memcpy(into.name, from.name, sizeof(into.name));
+        if (from.timeAccuracy != MESH_TIME_UNKNOWN) {
+            into.epoch = from.epoch;
+            into.timeAccuracy = from.timeAccuracy;
+            into.timeMillis = from.timeMillis;
+        }
+        if (from.hasInfo) {
+            into.hasInfo = true;
+            into.version = from.version;
+            into.role = from.role;
+            into.hops = from.hops;
+            into.stations = from.stations;
+            into.freeSlots = from.freeSlots;
+            into.uplinkRssi = from.uplinkRssi;
+            memcpy(into.ssid, from.ssid, sizeof(into.ssid));
+        }
+    }
+
+    // Μικρότερο = καλύτερο. Κάθε hop/station κοστίζει όσο μερικά dB RSSI.
+    static int parentCost(const Candidate& c) {
+        int cost = -c.rssi + BLE_COST_PER_HOP * c.hops + BLE_COST_PER_STATION * c.stations;
+        if (c.freeSlots == 0) cost += BLE_COST_AP_FULL;
+        if (c.uplinkRssi != 0 && c.uplinkRssi < BLE_UPLINK_RSSI_WEAK) cost += BLE_COST_WEAK_UPLINK;
+        return cost;
+    }
+
+    // Manufacturer data: MeshTimeInfo (advertisement), v1 = MeshBeaconInfo +
+    // SSID (scan response), αλλιώς legacy [role, SSID]
+    static void parseManufacturer(const uint8_t* data, size_t dataLen, Candidate& c) {
+        if (dataLen == 0) return;
+        if (dataLen == sizeof(MeshTimeInfo) && data[0] == MESH_TIME_MAGIC) {
+            MeshTimeInfo t;
+            memcpy(&t, data, sizeof(t));
+            if (t.accuracy != MESH_TIME_UNKNOWN) {
+                c.epoch = t.epoch;
+                c.timeAccuracy = t.accuracy;
+                c.timeMillis = millis();
+            }
+            return;
+        }
+        size_t ssidOff = 1;
+        if (dataLen >= sizeof(MeshBeaconInfo) && data[0] == MESH_BEACON_MAGIC &&
+            data[1] >= MESH_BEACON_VERSION) {
+            MeshBeaconInfo info;
+            memcpy(&info, data, sizeof(info));
+            c.version = info.version;
+            c.role = info.role;
+            c.hops = info.hops;
+            c.stations = info.stations;
+            c.freeSlots = info.freeSlots;
+            c.uplinkRssi = info.uplinkRssi;
+            ssidOff = sizeof(MeshBeaconInfo);
+        } else {
+            c.role = data[0];
+            c.hops = c.role == 1 ? 0 : 1;
+        }
+        size_t n = min(dataLen - ssidOff, sizeof(c.ssid) - 1);
+        memcpy(c.ssid, data + ssidOff, n);
+        c.ssid[n] = '\0';
+        c.hasInfo = true;
+    }
+
+    class ScanCallbacks : public BLEAdvertisedDeviceCallbacks {
+    public:
+        BLEScannerManager* owner = nullptr;
+        void onResult(BLEAdvertisedDevice device) override {
+            if (owner) owner->onAdvertisement(device);
+        }
+    };
+
+    // Το completion callback του BLEScan δεν παίρνει context
+    static volatile bool& scanDone() {
+        static volatile bool done = false;
+        return done;
+    }
+    static void onScanComplete(BLEScanResults) { scanDone() = true; }
+
+    static uint8_t hexNibble(char h) {
+        return (h >= 'a') ? h - 'a' + 10 : (h >= 'A') ? h - 'A' + 10 : h - '0';
+    }
+
+    // BLE_MESH_SERVICE_UUID όπως εμφανίζεται στο advertisement (little-endian)
+    static const uint8_t* meshUuidLE() {
+        static uint8_t uuid[16];
+        static bool ready = false;
+        if (!ready) {
+            const char* p = BLE_MESH_SERVICE_UUID;
+            int n = 15;
+            while (*p && n >= 0) {
+                if (*p == '-') { p++; continue; }
+                uuid[n--] = (uint8_t)((hexNibble(p[0]) << 4) | hexNibble(p[1]));
+                p += 2;
+            }
+            ready = true;
+        }
+        return uuid;
+    }
+
+    // Τρέχει στο BT task: parse των AD structures του raw payload, χωρίς
+    // αντίγραφα std::string/String
+    void onAdvertisement(BLEAdvertisedDevice& device) {
+        const uint8_t* p = device.getPayload();
+        size_t len = device.getPayloadLength();
+        if (!p || len == 0) return;
+
+        Candidate c;
+        bool mesh = false;
+        size_t i = 0;
+        while (i + 1 < len) {
+            uint8_t fieldLen = p[i];
+            if (fieldLen == 0 || i + 1 + fieldLen > len) break;
+            uint8_t type = p[i + 1];
+            const uint8_t* data = p + i + 2;
+            size_t dataLen = fieldLen - 1;
+            switch (type) {
+                case 0x06:  // incomplete / complete list of 128-bit UUIDs
+                case 0x07:
+                    for (size_t k = 0; k + 16 <= dataLen; k += 16) {
+                        if (memcmp(data + k, meshUuidLE(), 16) == 0) mesh = true;
+                    }
+                    break;
+                case 0x08:  // shortened / complete local name
+                case 0x09: {
+                    size_t n = min(dataLen, sizeof(c.name) - 1);
+                    memcpy(c.name, data, n);
+                    c.name[n] = '\0';
+                    break;
+                }
+                case 0xFF:  // manufacturer data
+                    parseManufacturer(data, dataLen, c);
+                    break;
+            }
+            i += 1 + fieldLen;
+        }
+        // Scan response μόνο του (χωρίς UUID): αναγνωρίζεται από το magic
+        if (!mesh && c.version == 0) return;
+
+        c.valid = true;
+        c.rssi = device.getRSSI();
+        memcpy(c.addr, device.getAddress().getNative(), sizeof(c.addr));
+
+        portENTER_CRITICAL(&candMux);
+        // Advertisement και scan response του ίδιου node ενώνονται σε ένα candidate
+        Candidate* slot = nullptr;
+        for (Candidate& k : cands) {
+            if (k.valid && memcmp(k.addr, c.addr, sizeof(c.addr)) == 0) { slot = &k; break; }
+        }
+        if (!slot) {
+            for (Candidate& k : cands) {
+                if (!k.valid) { slot = &k; break; }
+            }
+        }
+        if (slot) {
+            if (slot->valid) {
+                merge(*slot, c);
+            } else {
+                *slot = c;
+            }
+            slot->cost = parentCost(*slot);
+            if (usable(*slot)) {
+                bool idle = slot->hops <= 1 && slot->stations == 0 && slot->freeSlots > 0;
+                if (idle && slot->rssi >= BLE_PARENT_RSSI_STRONG) strongSeen = true;
+                if (!firstSeenMillis) firstSeenMillis = millis();
+            }
+        }
+        portEXIT_CRITICAL(&candMux);
+    }
+
     BLEScan* pBLEScan = nullptr;
     bool isInitialized = false;
+    ScanCallbacks callbacks;
+    portMUX_TYPE candMux = portMUX_INITIALIZER_UNLOCKED;
+    Candidate cands[BLE_MAX_CANDIDATES];
+    uint32_t firstSeenMillis = 0;
+    bool strongSeen = false;
 };
 
 #endif // BLE_MESH_BEACON_H
@@ -0,0 +1,94 @@
+#include "body_arena.h"
+
+static_assert(BODY_ARENA_SIZE <= 0xFFFF, "BodyArena offsets are 16-bit");
+
+BodyArena::Slot* BodyArena::find(AsyncWebServerRequest* req) {
+    for (Slot& s : slots) {
+        if (s.owner == req) return &s;
+    }
+    return nullptr;
+}
+
+// Request που κόπηκε χωρίς disconnect callback δεν κρατάει χώρο για πάντα
+void BodyArena::reclaimStale() {
+    uint32_t now = millis();
+    for (Slot& s : slots) {
+        if (s.owner && now - s.startedMillis > BODY_ARENA_TIMEOUT_MS) {
+            Serial.printf("[BODY] Dropping stale body (%u/%u bytes)\n",
+                          (unsigned)s.received, (unsigned)s.size);
+            s.owner = nullptr;
+        }
+    }
+}
+
+// First fit: το χαμηλότερο offset που δεν επικαλύπτει κανένα ενεργό slot
+BodyArena::Slot* BodyArena::acquire(AsyncWebServerRequest* req, size_t total) {
+    reclaimStale();
+    Slot* freeSlot = nullptr;
+    for (Slot& s : slots) {
+        if (!s.owner) {
+            freeSlot = &s;
+            break;
+        }
+    }
+    if (!freeSlot) return nullptr;
+
+    size_t start = 0;
+    bool moved = true;
+    while (moved) {
+        moved = false;
+        if (start + total > BODY_ARENA_SIZE) return nullptr;
+        for (const Slot& s : slots) {
+            if (s.owner && start < (size_t)s.offset + s.size && (size_t)s.offset < start + total) {
+                start = (size_t)s.offset + s.size;
+                moved = true;
+            }
+        }
+    }
+
+    freeSlot->owner = req;
+    freeSlot->offset = (uint16_t)start;
+    freeSlot->size = (uint16_t)total;
+    freeSlot->received = 0;
+    freeSlot->startedMillis = millis();
+    req->onDisconnect([this, req]() { release(req); });
+    return freeSlot;
+}
+
+BodyArena::Result BodyArena::feed(AsyncWebServerRequest* req, uint8_t* data, size_t len,
+                                  size_t index, size_t total, size_t maxTotal,
+                                  uint8_t*& body, size_t& bodyLen) {
+    if (index == 0) {
+        if (total > maxTotal) return BODY_TOO_LARGE;
+        if (len == total) {
+            // Όλο το body σε ένα chunk: χωρίς αντιγραφή
+            body = data;
+            bodyLen = len;
+            return BODY_COMPLETE;
+        }
+        if (!acquire(req, total)) {
+            Serial.printf("[BODY] Arena full, rejecting %u byte body\n", (unsigned)total);
+            return BODY_BUSY;
+        }
+    }
+
+    Slot* s = find(req);
+    if (!s) return BODY_IGNORE;
+    if (index != s->received || index + len > s->size) {
+        // Εκτός σειράς ή πάνω από το Content-Length: δεν εμπιστευόμαστε το body
+        release(req);
+        return BODY_IGNORE;
+    }
+    memcpy(buf + s->offset + index, data, len);
+    s->received += len;
+    if (s->received < s->size) return BODY_PARTIAL;
+
+    body = buf + s->offset;
+    bodyLen = s->size;
+    return BODY_COMPLETE;
+}
+
+void BodyArena::release(AsyncWebServerRequest* req) {
+    Slot* s = find(req);
+    if (s) s->owner = nullptr;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "config.h"
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// Reassembly των request bodies που έρχονται σε πολλά chunks (TCP segments)
+// για τα μικρά JSON endpoints του sensor AP (/event/heartbeat, /api/status).
+// Ένα body σε ένα chunk (η συνηθισμένη περίπτωση) περνάει κατευθείαν χωρίς
+// αντιγραφή. Αλλιώς στο πρώτο chunk δεσμεύεται χώρος total bytes από ένα
+// στατικό buffer BODY_ARENA_SIZE (first fit) και το body δίνεται ολόκληρο
+// μόλις φτάσει το τελευταίο chunk. Χωρίς heap. Όλα τα callbacks τρέχουν στο
+// AsyncTCP task, οπότε δεν χρειάζεται lock.
+class BodyArena {
+public:
+    enum Result : uint8_t {
+        BODY_PARTIAL,    // περιμένουμε κι άλλα chunks
+        BODY_COMPLETE,   // body/bodyLen έτοιμα, μετά release(req)
+        BODY_TOO_LARGE,  // total > maxTotal (ήδη στο πρώτο chunk) -> 413
+        BODY_BUSY,       // δεν χωράει τώρα στο arena -> 503
+        BODY_IGNORE,     // chunk request που έχει ήδη απαντηθεί
+    };
+
+    Result feed(AsyncWebServerRequest* req, uint8_t* data, size_t len,
+                size_t index, size_t total, size_t maxTotal,
+                uint8_t*& body, size_t& bodyLen);
+    void release(AsyncWebServerRequest* req);
+
+private:
+    struct Slot {
+        AsyncWebServerRequest* owner = nullptr;
+        uint16_t offset = 0;
+        uint16_t size = 0;
+        uint16_t received = 0;
+        uint32_t startedMillis = 0;
+    };
+
+    Slot* find(AsyncWebServerRequest* req);
+    Slot* acquire(AsyncWebServerRequest* req, size_t total);
+    void reclaimStale();
+
+    uint8_t buf[BODY_ARENA_SIZE];
+    Slot slots[BODY_ARENA_MAX_REQUESTS];
+};
@@ -57,6 +57,57 @@
 #define MESSAGE_CACHE_SIZE      10
 #define SENSOR_DATA_FILENAME    "/sensordata.bin"
 
+// Sensor jobs (collector AP)
+#define MAX_PARALLEL_SENSOR_JOBS 4   // FW/CONFIG jobs που τρέχουν ταυτόχρονα
+#define SENSOR_JOB_QUEUE_SIZE    8   // sensors που περιμένουν ελεύθερο slot
+#define JOB_STORE_INDEX_BYTES    16384 // μέγιστο index ανά job file (8 bytes ανά slot, load factor 75% => 1536 jobs)
+#define JOB_COMPACT_IDLE_MS      30000 // χωρίς heartbeat τόσο => compaction των job files
+#define JOB_SYNC_MAX_IDS         4096 // root: job ids στο journal index (8 bytes το καθένα)
+#define JOB_SYNC_MAX_RESPONSE    8192 // bytes αλλαγών ανά /jobs/since response
+#define JOB_SYNC_MAX_ROUNDS      8    // collector: responses ανά sync
+#define JOB_SYNC_REFRESH_MS      5000 // root: έλεγχος των job files για αλλαγές (από το loop)
+#define JOB_SYNC_LOCK_MS         200  // root: αναμονή για το SD bus στο /jobs/since, μετά 503
+#define SENSOR_JOB_TASK_STACK    6144 // bytes, task που τρέχει τα FW/CONFIG transfers
+#define HB_LOG_PENDING           64   // heartbeat records (32 bytes) στη RAM πριν το flush
+#define HB_LOG_FLUSH_MS          5000 // μέγιστη καθυστέρηση heartbeat log -> SD
+#define STATUS_LOG_MAX_SENSORS   64   // sensors στο /received/status.bin
+#define STATUS_LOG_SLOTS         100  // records ανά sensor (ring), όπως το ιστορικό του sensorsdaemon
+#define SENSOR_REGISTRY_CAPACITY 64   // slots του sensor registry στη RTC memory (16 bytes το καθένα)
+#define SENSOR_REGISTRY_MAX_LIVE 48   // sensors πριν το LRU eviction (load factor 0.75)
+#define BODY_ARENA_SIZE          4096 // bytes για bodies σε πολλά chunks (heartbeat, /api/status)
+#define BODY_ARENA_MAX_REQUESTS  8    // ταυτόχρονα bodies σε reassembly
+#define BODY_ARENA_TIMEOUT_MS    10000 // body που δεν ολοκληρώθηκε τόσο => ο χώρος ελευθερώνεται
+#define HEARTBEAT_MAX_BODY       512  // bytes, /event/heartbeat
+#define STATUS_MAX_BODY          1024 // bytes, /api/status
+#define HB_ALLOC_AUDIT           0    // 1: μετράει heap blocks στο /event/heartbeat path (heap_caps_get_info, μόνο για debug)
+
+// BLE parent discovery (collector/repeater scan)
+#define BLE_KEEP_RESIDENT        1    // Classic BT μνήμη πίσω στο heap στο boot, BLE controller idle ανάμεσα στα scans
+#define BLE_PARENT_RSSI_STRONG   -75  // dBm: parent τόσο δυνατός => το scan σταματά αμέσως
+#define BLE_SCAN_CONFIRM_MS      400  // μετά τον πρώτο (πιο αδύναμο) parent, αναμονή για καλύτερο
+#define PARENT_CACHE_RESCAN_CYCLES 96 // uplink windows με τον cached parent πριν ξανά BLE scan (~1 μέρα ανά 15 λεπτά)
+#define PARENT_CACHE_CONNECT_MS  8000 // connect στον cached parent πριν θεωρηθεί χαμένος
+#define BLE_MAX_CANDIDATES       8    // mesh nodes που συγκρίνονται ανά scan
+#define BLE_COST_PER_HOP         10   // cost ανά hop ως τον root (σε dB RSSI)
+#define BLE_COST_PER_STATION     6    // cost ανά collector συνδεδεμένο στον parent
+#define BLE_COST_AP_FULL         40   // parent χωρίς ελεύθερο slot στο AP
+#define BLE_UPLINK_RSSI_WEAK     -80  // dBm: parent με τόσο αδύναμο uplink...
+#define BLE_COST_WEAK_UPLINK     15   // ...παίρνει αυτό το cost
+#define MESH_AP_MAX_STATIONS     4    // clients του repeater AP (default max_connection του WiFi.softAP)
+#define MESH_BEACON_REFRESH_MS   5000 // ανανέωση hops/stations/uplink στο beacon
+#define MESH_TIME_REFRESH_MS     2000 // ανανέωση της ώρας στο advertisement του repeater
+#define MESH_TIME_DRIFT_PPM      50   // drift του ρολογιού μετά το sync, για το accuracy
+#define MESH_TIME_HTTP_ACCURACY_S 1   // accuracy του sync από το /time του uplink
+#define MESH_TIME_RESYNC_ACCURACY_S 5 // repeater: νέο /time sync όταν το accuracy ξεπεράσει αυτό
+#define MESH_TIME_RESYNC_RETRY_MS 600000 // ελάχιστο διάστημα ανάμεσα στα /time sync του repeater
+#define BLE_TIME_MAX_ACCURACY_S  10   // collector: δέχεται ώρα από BLE μόνο με τόσο accuracy
+#define BLE_ADV_FAST_MS          100  // repeater advertising γύρω από τα uplink windows
+#define BLE_ADV_SLOW_MS          1280 // ενδιάμεσα (0 = παύση, τότε cold-start collectors δεν τον βρίσκουν)
+#define BLE_ADV_FAST_BEFORE_S    30   // fast πριν το όριο του uplink (οι collectors ξυπνούν 20 s νωρίτερα)
+#define BLE_ADV_FAST_AFTER_S     60   // fast μετά το όριο (collectors via repeater ξυπνούν +30 s)
+#define BLE_ADV_ARRIVAL_MARGIN_S 30   // fast ± τόσο γύρω από όπου έχουν φανεί collectors
+#define BLE_ADV_MAX_ARRIVALS     8    // θέσεις collector arrivals που θυμάται ο repeater
+
 // Enums
 enum UplinkRoute { UPLINK_DIRECT, UPLINK_VIA_REPEATER };
 enum NodeRole { ROLE_REPEATER, ROLE_COLLECTOR, ROLE_ROOT };
@@ -102,6 +153,7 @@ extern Adafruit_NeoPixel pixel;
 extern SdFat sd;
 extern NodeConfig config;
 extern SemaphoreHandle_t sdCardMutex;
+extern SemaphoreHandle_t sdBusMutex;
 extern bool isOperationalMode;
 
 // Prototypes
@@ -116,7 +168,20 @@ void setupStatusLed();
 void setStatusLed(Status newStatus);
 void loopStatusLed();
 bool initSdCard();
+bool sdBusLock(uint32_t timeoutMs);
+void sdBusUnlock();
 void persistRtcTime(time_t epoch);
 time_t restoreRtcTime();
 
+// SD + NVS ανάμεσα στο main loop και το job task (recursive).
+// Μόνο γύρω από τις κλήσεις SD/NVS (block του .hex, checkpoint, stats,
+// job files), ποτέ γύρω από network I/O.
+struct SdBusGuard {
+    SdBusGuard() { sdBusLock(portMAX_DELAY); }
+    ~SdBusGuard() {
+        sdBusUnlock();
+        taskYIELD();
+    }
+};
+
 #endif // CONFIG_H
\ No newline at end of file
@@ -3,21 +3,33 @@
 #include <WiFi.h>
 #include <WiFiClient.h>
 
+// CONFIGURE που δεν πήρε HTTP 200: ξανά μετά από backoff, ως CFG_MAX_TRIES φορές
+static const int CFG_MAX_TRIES = 3;
+static const unsigned long CFG_BACKOFF_BASE_MS = 1000UL;
+
 // Simple CONFIGURE HTTP GET (Diagnonic style)
-// No JSON response, we only check if body contains "OK".
-bool cu_sendConfiguration(const ConfigJob& job)
+// No JSON response, we only log the body.
+bool ConfigTransfer::begin(const ConfigJob& job)
 {
+    abort();
+    sn = job.sensorSn;
+    done = false;
+    ok = false;
+    tries = 0;
+    waiting = false;
+
     Serial.printf("[CONFIG] Starting configuration update for SN=%s IP=%s\n",
                   job.sensorSn.c_str(), job.sensorIp.c_str());
 
     if (job.sensorIp.length() == 0) {
         Serial.println("[CONFIG] ERROR: empty sensor IP");
+        done = true;
         return false;
     }
 
     // Time stamp in ms, like python (epoch_ms). If we don't have real epoch, millis() is still monotonic.
     unsigned long epochMs = millis();
-    String query = "/api?command=CONFIGURE&datetime=" + String(epochMs) + "&";
+    query = "/api?command=CONFIGURE&datetime=" + String(epochMs) + "&";
 
     // Append params from JSON
     for (JsonPair kv : job.params) {
@@ -26,50 +38,69 @@ bool cu_sendConfiguration(const ConfigJob& job)
         query += String(key) + "=" + value + "&";
     }
 
-    // Simple HTTP GET with 5-second timeout (matching Python daemon)
-    WiFiClient client;
-    String request =
-        String("GET ") + query + " HTTP/1.1\r\n" +
-        "Host: " + job.sensorIp + "\r\n" +
-        "Connection: close\r\n\r\n";
-
     Serial.printf("[CONFIG] HTTP GET http://%s%s\n",
                   job.sensorIp.c_str(), query.c_str());
 
-    if (!client.connect(job.sensorIp.c_str(), 80)) {
+    // 5-second timeout (matching Python daemon), Connection: close
+    link.setHost(job.sensorIp, false);
+    if (!link.begin(query.c_str(), 5000UL, body, sizeof(body))) {
         Serial.println("[CONFIG] ERROR: Cannot connect to sensor");
+        done = true;
         return false;
     }
+    return true;
+}
+
+void ConfigTransfer::tryFailed()
+{
+    tries++;
+    if (tries >= CFG_MAX_TRIES) {
+        Serial.printf("[CONFIG] ERROR: giving up on SN=%s after %d tries\n", sn.c_str(), tries);
+        done = true;
+        return;
+    }
+    unsigned long backoff = CFG_BACKOFF_BASE_MS << (tries - 1);
+    Serial.printf("[CONFIG] SN=%s: try %d failed, retrying in %lu ms...\n", sn.c_str(), tries, backoff);
+    waitUntil = millis() + backoff;
+    waiting = true;
+}
 
-    client.print(request);
+bool ConfigTransfer::poll()
+{
+    if (done) return true;
 
-    // Wait for response with 5-second timeout (matching Python daemon)
-    unsigned long start = millis();
-    String response;
-    while (millis() - start < 5000UL) {
-        while (client.available()) {
-            char c = client.read();
-            response += c;
+    if (waiting) {
+        if ((long)(millis() - waitUntil) < 0) return false;
+        waiting = false;
+        if (!link.begin(query.c_str(), 5000UL, body, sizeof(body))) {
+            tryFailed();
         }
-        if (!client.connected() && response.length() > 0) break;
-        delay(10);
+        return done;
     }
-    client.stop();
 
-    // Extract body from response
-    int headerEnd = response.indexOf("\r\n\r\n");
-    String body = (headerEnd >= 0) ? response.substring(headerEnd + 4) : response;
+    SensorHttpResult r = link.poll();
+    if (r == SENSOR_HTTP_PENDING) return false;
+    link.close();
 
-    // Log response but don't fail based on it (matching Python daemon behavior)
-    // Python daemon logs the response but always clears the flag regardless
-    if (body.length() > 0) {
-        Serial.println("[CONFIG] Response:");
+    if (r == SENSOR_HTTP_DONE && body[0] != '\0') {
+        Serial.printf("[CONFIG] Response from SN=%s (HTTP %d):\n", sn.c_str(), link.lastStatus());
         Serial.println(body);
     } else {
-        Serial.println("[CONFIG] No response body received");
+        Serial.printf("[CONFIG] No response body received from SN=%s\n", sn.c_str());
     }
 
-    // Always return true - config was sent (Python daemon behavior)
-    // If sensor is busy (uploading data), it will get the config on next attempt
+    // Μόνο HTTP 200 σημαίνει ότι ο sensor πήρε το config· αλλιώς το job μένει
+    if (r != SENSOR_HTTP_DONE || !link.lastOk()) {
+        tryFailed();
+        return done;
+    }
+    done = true;
+    ok = true;
     return true;
 }
+
+void ConfigTransfer::abort()
+{
+    link.close();
+    done = true;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "sensor_http.h"
 
 // Configuration job description (per sensor SN)
 struct ConfigJob {
@@ -9,5 +10,30 @@ struct ConfigJob {
     JsonObject params; // reference to JSON "params" object
 };
 
-// Send CONFIGURE command to a sensor, using Diagnonic HTTP GET
-bool cu_sendConfiguration(const ConfigJob& job);
+// CONFIGURE ενός sensor χωρίς blocking.
+// Το query χτίζεται στο begin(), οπότε το params (και το JSON doc) δεν
+// χρειάζεται να ζει όσο τρέχει το request.
+class ConfigTransfer {
+public:
+    bool begin(const ConfigJob& job);
+    // false όσο περιμένουμε απάντηση (ή backoff μετά από HTTP != 200)
+    bool poll();
+    void abort();
+
+    bool finished() const { return done; }
+    bool succeeded() const { return ok; }
+    const String& sensorSn() const { return sn; }
+
+private:
+    void tryFailed();
+
+    SensorHttpClient link;
+    String sn;
+    String query;
+    char body[256];
+    bool done = true;
+    bool ok = false;
+    int tries = 0;
+    bool waiting = false;       // backoff πριν το επόμενο try
+    unsigned long waitUntil = 0;
+};
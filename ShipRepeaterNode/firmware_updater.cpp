@@ -1,68 +1,43 @@
 #include "firmware_updater.h"
 #include <WiFi.h>
-#include <WiFiClient.h>
-#include <vector>
 
 // SD from elsewhere
 extern SdFat sd;
 extern bool initSdCard();
 
-// ------------------------------------------
-// Simple HTTP GET helper (no JSON parsing)
-// ------------------------------------------
-static bool httpGetSensor(const String& hostIp,
-                          const String& pathAndQuery,
-                          String& bodyOut,
-                          unsigned long timeoutMs = 5000UL)
-{
-    WiFiClient client;
-
-    String request =
-        String("GET ") + pathAndQuery + " HTTP/1.1\r\n" +
-        "Host: " + hostIp + "\r\n" +
-        "Connection: close\r\n\r\n";
-
-    Serial.printf("[FW] HTTP GET http://%s%s\n",
-                  hostIp.c_str(), pathAndQuery.c_str());
-
-    if (!client.connect(hostIp.c_str(), 80)) {
-        Serial.println("[FW] ERROR: connect() failed");
-        return false;
-    }
+static const int FW_MAX_TRIES = 5;
+static const unsigned long FW_LINE_TIMEOUT_MS = 5000UL;
 
-    client.print(request);
+// Κενό μεταξύ γραμμών: ξεκινά από 10 ms, μειώνεται κατά 1 ms σε κάθε γραμμή
+// που απαντήθηκε κανονικά, διπλασιάζεται όταν ο sensor αργεί ή αποτυγχάνει.
+static const uint32_t FW_GAP_INIT_MS = 10;
+static const uint32_t FW_GAP_STEP_MS = 1;
+static const uint32_t FW_GAP_MAX_MS = 500;
+static const uint32_t FW_RTT_WARMUP = 8;    // samples πριν κρίνουμε "αργό" response
 
-    unsigned long start = millis();
-    String response;
+// Retry: 1 s, 2 s, 4 s, 8 s (+/- jitter ώστε οι sensors να μη συγχρονίζονται)
+static const unsigned long FW_BACKOFF_BASE_MS = 1000UL;
+static const unsigned long FW_BACKOFF_MAX_MS = 8000UL;
 
-    while (millis() - start < timeoutMs) {
-        while (client.available()) {
-            char c = client.read();
-            response += c;
-        }
-        if (!client.connected()) break;
-        delay(1);
-    }
-    client.stop();
-
-    int headerEnd = response.indexOf("\r\n\r\n");
-    if (headerEnd >= 0) {
-        bodyOut = response.substring(headerEnd + 4);
-    } else {
-        bodyOut = response;
-    }
-
-    if (bodyOut.length() == 0) {
-        Serial.println("[FW] WARNING: empty body");
-    }
-    return true;
-}
+static const char* FW_STATS_PATH = "/received/fw_stats.csv";
 
 // ------------------------------------------
-// Execute firmware job (Intel HEX over HTTP)
+// Setup: image, checkpoint
 // ------------------------------------------
-bool executeFirmwareJob(const FirmwareJob& job)
+bool FirmwareTransfer::begin(const FirmwareJob& job)
 {
+    abort();
+    fwJob = job;
+    state = FW_IDLE;
+    resumedFrom = 0;
+    tries = 0;
+    gapMs = FW_GAP_INIT_MS;
+    srttMs = rttVarMs = rttMinMs = rttMaxMs = 0;
+    rttSamples = 0;
+    latencySumMs = 0;
+    retries = 0;
+    slowDowns = 0;
+
     Serial.printf("[FW] Starting firmware job for SN=%s IP=%s\n",
                   job.sensorSN.c_str(), job.sensorIp.c_str());
 
@@ -76,102 +51,374 @@ bool executeFirmwareJob(const FirmwareJob& job)
         return false;
     }
 
-    if (!sd.exists(job.hexPath.c_str())) {
+    bool hexExists;
+    {
+        SdBusGuard sdBus;
+        hexExists = sd.exists(job.hexPath.c_str());
+    }
+    if (!hexExists) {
         Serial.printf("[FW] ERROR: hex file not found: %s\n",
                       job.hexPath.c_str());
         return false;
     }
 
-    FsFile f = sd.open(job.hexPath.c_str(), O_RDONLY);
-    if (!f) {
+    // Streaming reader: σταθερή μνήμη ανεξάρτητα από το μέγεθος του image
+    if (!reader.open(job.hexPath.c_str())) {
         Serial.printf("[FW] ERROR: cannot open hex file: %s\n",
                       job.hexPath.c_str());
         return false;
     }
 
-    // Read file into lines
-    std::vector<String> lines;
-    String cur;
-    while (f.available()) {
-        char c = f.read();
-        if (c == '\r') {
-            continue;
-        } else if (c == '\n') {
-            if (cur.length() > 0) {
-                lines.push_back(cur);
-                cur = "";
-            }
+    if (reader.fileSize() == 0) {
+        Serial.println("[FW] ERROR: hex file is empty");
+        reader.close();
+        return false;
+    }
+
+    Serial.printf("[FW] Streaming %s (%lu bytes)\n",
+                  job.hexPath.c_str(), (unsigned long)reader.fileSize());
+
+    totalTimeoutMs =
+        (job.totalTimeoutMs > 0) ? job.totalTimeoutMs : (8UL * 60UL * 1000UL);
+    startMs = millis();
+    link.setHost(job.sensorIp, job.keepAlive);
+
+    // Checkpoint: αν το ίδιο image είχε μείνει στη μέση και ο sensor είναι
+    // ακόμα σε bootloader, συνεχίζουμε από το τελευταίο acked record.
+    ack = FirmwareCheckpoint();
+    if (!reader.source()->imageHash(ack.imageHash, ack.imageSize)) {
+        Serial.println("[FW] WARNING: cannot hash image, checkpoints disabled");
+    }
+    if (fwc_load(job.sensorSN, saved)) {
+        if (saved.imageHash != ack.imageHash || saved.imageSize != ack.imageSize) {
+            Serial.println("[FW] Checkpoint is for a different image, starting over");
+            fwc_clear(job.sensorSN);
         } else {
-            cur += c;
+            startStatusCheck();
+            return state != FW_FAILED;
         }
     }
-    if (cur.length() > 0) {
-        lines.push_back(cur);
+
+    Serial.printf("[FW] HTTP GET http://%s%s... (%s)\n",
+                  job.sensorIp.c_str(), HEX_REQUEST_PREFIX,
+                  job.keepAlive ? "keep-alive" : "connection per line");
+    state = FW_NEXT_LINE;
+    return true;
+}
+
+// STATUS: FIRMWARE_VERSION=BL_... σημαίνει bootloader mode (όπως στο sensorsdaemon)
+void FirmwareTransfer::startStatusCheck()
+{
+    snprintf(statusPath, sizeof(statusPath), "/api?command=STATUS&datetime=%lu&", millis());
+    if (!link.begin(statusPath, FW_LINE_TIMEOUT_MS, statusBody, sizeof(statusBody))) {
+        // Κρατάμε το checkpoint για το επόμενο window
+        fail("STATUS before resume failed");
+        return;
     }
-    f.close();
+    state = FW_CHECK_STATUS;
+}
 
-    if (lines.empty()) {
-        Serial.println("[FW] ERROR: hex file is empty");
-        return false;
+void FirmwareTransfer::resumeAtCheckpoint()
+{
+    reader.seekTo(saved.offset, saved.records, saved.lineNo, saved.addrOffset);
+    ack = saved;
+    resumedFrom = saved.records;
+    Serial.printf("[FW] Resuming at record %u (offset %u)\n",
+                  (unsigned)saved.records, (unsigned)saved.offset);
+    state = FW_NEXT_LINE;
+}
+
+void FirmwareTransfer::saveCheckpoint()
+{
+    if (ack.imageSize == 0 || ack.records == 0) return;
+    if (!fwc_save(fwJob.sensorSN, ack)) {
+        Serial.println("[FW] WARNING: cannot save checkpoint");
     }
+}
 
-    Serial.printf("[FW] Loaded %u hex lines from %s\n",
-                  (unsigned)lines.size(), job.hexPath.c_str());
+// Στέλνει τη γραμμή που έχει ήδη κωδικοποιηθεί στο request buffer του reader
+void FirmwareTransfer::sendCurrentLine(unsigned long now)
+{
+    if (link.begin(reader.requestPath(), FW_LINE_TIMEOUT_MS)) {
+        state = FW_WAIT_LINE;
+    } else {
+        lineFailed(now);
+    }
+}
 
-    uint32_t maxLines = job.maxLines;
-    if (maxLines == 0 || maxLines > lines.size()) {
-        maxLines = lines.size();
+void FirmwareTransfer::lineFailed(unsigned long now)
+{
+    tries++;
+    retries++;
+    // Multiplicative decrease του ρυθμού και για τις επόμενες γραμμές
+    gapMs = min(max(gapMs * 2, FW_GAP_INIT_MS), FW_GAP_MAX_MS);
+    if (tries >= FW_MAX_TRIES) {
+        Serial.printf("[FW] ERROR: giving up at line %u\n", (unsigned)reader.recordIndex());
+        saveCheckpoint();
+        fail("line retries exhausted");
+        return;
     }
+    unsigned long backoff = min(FW_BACKOFF_BASE_MS << (tries - 1), FW_BACKOFF_MAX_MS);
+    backoff = backoff / 2 + (unsigned long)random((long)(backoff / 2) + 1);
+    Serial.printf("[FW] Line %u: try %d failed, retrying in %lu ms...\n",
+                  (unsigned)reader.recordIndex(), tries, backoff);
+    waitUntil = now + backoff;
+    state = FW_BACKOFF;
+}
 
-    unsigned long totalTimeoutMs =
-        (job.totalTimeoutMs > 0) ? job.totalTimeoutMs : (8UL * 60UL * 1000UL);
+// RTT όπως στο TCP (srtt/rttvar). Response πολύ πιο αργό από το συνηθισμένο
+// => ο sensor δεν προλαβαίνει, διπλασιάζουμε το κενό. Αλλιώς το μειώνουμε.
+void FirmwareTransfer::updatePacing(unsigned long rttMs, unsigned long latencyMs)
+{
+    uint32_t rtt = (uint32_t)rttMs;
+    bool slow = rttSamples >= FW_RTT_WARMUP && rtt > srttMs + 4 * rttVarMs;
 
-    unsigned long globalStart = millis();
-    const int MAX_TRIES = 3;
+    if (rttSamples == 0) {
+        srttMs = rtt;
+        rttVarMs = rtt / 2;
+        rttMinMs = rttMaxMs = rtt;
+    } else {
+        uint32_t err = (rtt > srttMs) ? rtt - srttMs : srttMs - rtt;
+        rttVarMs = (3 * rttVarMs + err) / 4;
+        srttMs = (7 * srttMs + rtt) / 8;
+        rttMinMs = min(rttMinMs, rtt);
+        rttMaxMs = max(rttMaxMs, rtt);
+    }
+    rttSamples++;
+    latencySumMs += latencyMs;
 
-    for (uint32_t i = 0; i < maxLines; ++i) {
-        if (millis() - globalStart > totalTimeoutMs) {
-            Serial.println("[FW] ERROR: global timeout reached");
-            return false;
-        }
+    if (slow) {
+        gapMs = min(max(gapMs * 2, FW_GAP_STEP_MS), FW_GAP_MAX_MS);
+        slowDowns++;
+    } else if (gapMs > 0) {
+        gapMs -= min(gapMs, FW_GAP_STEP_MS);
+    }
+}
 
-        String line = lines[i];
-        line.trim();
-        if (line.length() == 0) continue;
-        if (!line.startsWith(":")) {
-            Serial.printf("[FW] WARNING: skipping invalid line %u: %s\n",
-                          (unsigned)i, line.c_str());
-            continue;
-        }
+void FirmwareTransfer::lineAcked(unsigned long now)
+{
+    uint32_t i = reader.recordIndex();
+    ack.records = reader.recordCount();
+    ack.lineNo = reader.lineNumber();
+    ack.offset = (uint32_t)reader.bytesConsumed();
+    ack.addrOffset = (uint32_t)reader.lastAddressRecordOffset();
+    if (ack.records % FWC_SAVE_EVERY == 0) {
+        saveCheckpoint();
+    }
+    updatePacing(link.lastRttMs(), link.lastLatencyMs());
+    if ((i + 1) % 100 == 0) {
+        Serial.printf("[FW] SN=%s: %u records sent (srtt %u ms, gap %u ms)\n",
+                      fwJob.sensorSN.c_str(), (unsigned)(i + 1),
+                      (unsigned)srttMs, (unsigned)gapMs);
+    }
+    if (gapMs == 0) {
+        state = FW_NEXT_LINE;
+        return;
+    }
+    waitUntil = now + gapMs;
+    state = FW_PACE;
+}
 
-        // Replace ':' with '.' per Diagnonic requirement
-        String hexPayload = line;
-        hexPayload.replace(":", ".");
+// Μία γραμμή ανά job στο /received/fw_stats.csv
+void FirmwareTransfer::writeStats(bool ok)
+{
+    if (!initSdCard()) return;
+    SdBusGuard sdBus;
+    if (!sd.exists("/received")) sd.mkdir("/received");
+    bool isNew = !sd.exists(FW_STATS_PATH);
+    FsFile f = sd.open(FW_STATS_PATH, O_WRONLY | O_CREAT | O_APPEND);
+    if (!f) {
+        Serial.println("[FW] WARNING: cannot write firmware stats");
+        return;
+    }
+    if (isNew) {
+        f.println("time,sn,hex,result,records,resumed_from,elapsed_ms,lines_per_s,"
+                  "rtt_min_ms,srtt_ms,rtt_max_ms,latency_avg_ms,final_gap_ms,"
+                  "slowdowns,retries,connections");
+    }
+    time_t t;
+    time(&t);
+    unsigned long elapsedMs = millis() - startMs;
+    uint32_t sent = reader.recordCount() - resumedFrom;
+    f.printf("%lu,%s,%s,%s,%u,%u,%lu,%.1f,%u,%u,%u,%u,%u,%u,%u,%u\n",
+             (unsigned long)t, fwJob.sensorSN.c_str(), fwJob.hexPath.c_str(),
+             ok ? "OK" : "FAIL",
+             (unsigned)reader.recordCount(), (unsigned)resumedFrom, elapsedMs,
+             elapsedMs ? sent * 1000.0f / elapsedMs : 0.0f,
+             (unsigned)rttMinMs, (unsigned)srttMs, (unsigned)rttMaxMs,
+             (unsigned)(rttSamples ? latencySumMs / rttSamples : 0),
+             (unsigned)gapMs, (unsigned)slowDowns, (unsigned)retries,
+             (unsigned)link.connectCount());
+    f.close();
+}
 
-        String path = "/api?command=FIRMWARE_UPDATE&hex=" + hexPayload + "&d=0";
+void FirmwareTransfer::fail(const char* why)
+{
+    Serial.printf("[FW] ERROR: %s (SN=%s)\n", why, fwJob.sensorSN.c_str());
+    link.close();
+    reader.close();
+    state = FW_FAILED;
+    writeStats(false);
+}
+
+void FirmwareTransfer::finish()
+{
+    reader.close();
+    link.close();
+
+    if (reader.recordCount() == 0) {
+        Serial.println("[FW] ERROR: no valid hex records");
+        state = FW_FAILED;
+        writeStats(false);
+        return;
+    }
+    fwc_clear(fwJob.sensorSN);
+    if (resumedFrom > 0) {
+        Serial.printf("[FW] Resumed from record %u\n", (unsigned)resumedFrom);
+    }
 
-        bool ok = false;
-        for (int t = 0; t < MAX_TRIES; ++t) {
-            String body;
-            if (httpGetSensor(job.sensorIp, path, body, 5000UL)) {
-                ok = true;
+    unsigned long elapsedMs = millis() - startMs;
+    Serial.printf("[FW] SN=%s: sent %u hex records in %lu ms (%.1f lines/s, %u connections, %s)\n",
+                  fwJob.sensorSN.c_str(),
+                  (unsigned)reader.recordCount(), elapsedMs,
+                  elapsedMs ? (reader.recordCount() - resumedFrom) * 1000.0f / elapsedMs : 0.0f,
+                  (unsigned)link.connectCount(),
+                  link.isKeepAlive() ? "keep-alive" : "connection per line");
+    Serial.printf("[FW] RTT min/avg/max %u/%u/%u ms, final gap %u ms, %u slow-downs, %u retries\n",
+                  (unsigned)rttMinMs, (unsigned)srttMs, (unsigned)rttMaxMs,
+                  (unsigned)gapMs, (unsigned)slowDowns, (unsigned)retries);
+    Serial.println("[FW] Firmware update job completed successfully");
+    state = FW_DONE;
+    writeStats(true);
+}
+
+void FirmwareTransfer::abort()
+{
+    if (state != FW_IDLE && !finished()) {
+        Serial.printf("[FW] Aborting firmware job for SN=%s\n", fwJob.sensorSN.c_str());
+        saveCheckpoint();
+        writeStats(false);
+    }
+    link.close();
+    reader.close();
+    state = FW_IDLE;
+}
+
+// ------------------------------------------
+// State machine step (non-blocking)
+// ------------------------------------------
+FirmwareTransfer::State FirmwareTransfer::poll()
+{
+    if (finished() || state == FW_IDLE) {
+        return state;
+    }
+
+    unsigned long now = millis();
+    if (now - startMs > totalTimeoutMs) {
+        saveCheckpoint();
+        fail("global timeout reached");
+        return state;
+    }
+
+    switch (state) {
+    case FW_CHECK_STATUS: {
+        SensorHttpResult r = link.poll();
+        if (r == SENSOR_HTTP_PENDING) break;
+        if (r == SENSOR_HTTP_FAILED || !link.lastOk()) {
+            fail("STATUS before resume failed");
+            break;
+        }
+        char fv[32];
+        bool bootloader = shttp_statusField(statusBody, "FIRMWARE_VERSION", fv, sizeof(fv)) &&
+                          strncmp(fv, "BL_", 3) == 0;
+        if (!bootloader) {
+            Serial.println("[FW] Sensor not in bootloader mode, starting over");
+            fwc_clear(fwJob.sensorSN);
+            state = FW_NEXT_LINE;
+            break;
+        }
+        if (saved.offset == 0 || saved.offset > reader.fileSize()) {
+            Serial.println("[FW] WARNING: resume failed, starting over");
+            state = FW_NEXT_LINE;
+            break;
+        }
+        // Ξαναστέλνουμε το τελευταίο extended address record (02/04) ώστε ο
+        // bootloader να ξέρει το base address και μετά πάμε στο offset.
+        if (saved.addrOffset < saved.offset &&
+            reader.seekTo(saved.addrOffset, 0, 0, 0) &&
+            reader.next() == HEX_READ_OK &&
+            (reader.recordType() == 0x02 || reader.recordType() == 0x04)) {
+            if (!link.begin(reader.requestPath(), FW_LINE_TIMEOUT_MS)) {
+                fail("cannot resend address record");
                 break;
             }
-            Serial.printf("[FW] Line %u: try %d failed, retrying...\n",
-                          (unsigned)i, t + 1);
-            delay(4000);
+            state = FW_RESUME_ADDR;
+            break;
+        }
+        resumeAtCheckpoint();
+        break;
+    }
+
+    case FW_RESUME_ADDR: {
+        SensorHttpResult r = link.poll();
+        if (r == SENSOR_HTTP_PENDING) break;
+        if (r == SENSOR_HTTP_FAILED || !link.lastOk()) {
+            fail("cannot resend address record");
+            break;
         }
+        resumeAtCheckpoint();
+        break;
+    }
 
-        if (!ok) {
-            Serial.printf("[FW] ERROR: giving up at line %u\n", (unsigned)i);
-            return false;
+    case FW_NEXT_LINE: {
+        if (fwJob.maxLines != 0 && reader.recordCount() >= fwJob.maxLines) {
+            finish();
+            break;
+        }
+        HexReadResult rr = reader.next();
+        if (rr == HEX_READ_EOF) {
+            finish();
+            break;
+        }
+        if (rr != HEX_READ_OK) {
+            Serial.printf("[FW] ERROR: %s at hex line %u, aborting\n",
+                          HexLineReader::resultToString(rr),
+                          (unsigned)reader.lineNumber());
+            fail("invalid hex image");
+            break;
         }
+        tries = 0;
+        sendCurrentLine(now);
+        break;
+    }
 
-        // Small delay to avoid overwhelming the sensor
-        delay(10);
-        esp_task_wdt_reset();
+    case FW_WAIT_LINE: {
+        SensorHttpResult r = link.poll();
+        if (r == SENSOR_HTTP_PENDING) break;
+        // HTTP != 200: ο sensor δεν πήρε τη γραμμή, ούτε ack ούτε checkpoint
+        if (r == SENSOR_HTTP_DONE && link.lastOk()) {
+            lineAcked(now);
+        } else {
+            if (r == SENSOR_HTTP_DONE) {
+                Serial.printf("[FW] Line %u: HTTP %d\n", (unsigned)reader.recordIndex(), link.lastStatus());
+            }
+            lineFailed(now);
+        }
+        break;
     }
 
-    Serial.println("[FW] Firmware update job completed successfully");
-    return true;
+    case FW_BACKOFF:
+        if ((long)(now - waitUntil) < 0) break;
+        sendCurrentLine(now);
+        break;
+
+    case FW_PACE:
+        if ((long)(now - waitUntil) < 0) break;
+        state = FW_NEXT_LINE;
+        break;
+
+    default:
+        break;
+    }
+    return state;
 }
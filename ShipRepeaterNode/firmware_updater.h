@@ -2,6 +2,9 @@
 
 #include "config.h"
 #include <Arduino.h>
+#include "hex_line_reader.h"
+#include "sensor_http.h"
+#include "fw_checkpoint.h"
 
 // Περιγραφή ενός firmware job που έρχεται από JSON
 struct FirmwareJob {
@@ -10,8 +13,74 @@ struct FirmwareJob {
   String hexPath;         // π.χ. "/firmware/vibration_sensor_app_v1.17.hex"
   uint32_t maxLines;      // 0 => όλες οι γραμμές
   uint32_t totalTimeoutMs; // συνολικό timeout (π.χ. 8 λεπτά)
+  bool keepAlive = true;   // ένα HTTP/1.1 connection για όλες τις γραμμές
 };
 
-// Εκτελεί ολόκληρο το firmware update βάσει FirmwareJob.
-// Γυρίζει true/false ανάλογα με το αν ολοκληρώθηκε χωρίς error.
-bool executeFirmwareJob(const FirmwareJob& job);
+// Firmware update ενός sensor ως non-blocking state machine.
+// begin() ανοίγει το image (κοινό με άλλους sensors), poll() προχωράει
+// όσο επιτρέπει το δίκτυο χωρίς delay(), ώστε πολλά updates να τρέχουν μαζί.
+class FirmwareTransfer {
+public:
+  enum State {
+    FW_IDLE,
+    FW_CHECK_STATUS,   // STATUS πριν το resume (bootloader;)
+    FW_RESUME_ADDR,    // ξαναστέλνουμε το τελευταίο 02/04 record
+    FW_NEXT_LINE,
+    FW_WAIT_LINE,
+    FW_BACKOFF,        // αναμονή πριν το retry
+    FW_PACE,           // μικρό κενό μεταξύ γραμμών
+    FW_DONE,
+    FW_FAILED
+  };
+
+  bool begin(const FirmwareJob& job);
+  State poll();
+  void abort();
+
+  bool finished() const { return state == FW_DONE || state == FW_FAILED; }
+  bool succeeded() const { return state == FW_DONE; }
+  State currentState() const { return state; }
+  const FirmwareJob& job() const { return fwJob; }
+  uint32_t recordsSent() const { return reader.recordCount(); }
+
+private:
+  void fail(const char* why);
+  void finish();
+  void startStatusCheck();
+  void resumeAtCheckpoint();
+  void saveCheckpoint();
+  void sendCurrentLine(unsigned long now);
+  void lineFailed(unsigned long now);
+  void lineAcked(unsigned long now);
+  void updatePacing(unsigned long rttMs, unsigned long latencyMs);
+  void writeStats(bool ok);
+
+  FirmwareJob fwJob;
+  HexLineReader reader;
+  SensorHttpClient link;
+  State state = FW_IDLE;
+
+  FirmwareCheckpoint ack;
+  FirmwareCheckpoint saved;
+  uint32_t resumedFrom = 0;
+
+  unsigned long startMs = 0;
+  unsigned long totalTimeoutMs = 0;
+  unsigned long waitUntil = 0;
+  int tries = 0;
+
+  // Adaptive pacing: AIMD στο κενό μεταξύ γραμμών με βάση το RTT,
+  // exponential backoff με jitter στα retries
+  uint32_t gapMs = 0;
+  uint32_t srttMs = 0;       // smoothed RTT
+  uint32_t rttVarMs = 0;
+  uint32_t rttMinMs = 0;
+  uint32_t rttMaxMs = 0;
+  uint32_t rttSamples = 0;
+  uint64_t latencySumMs = 0; // μέχρι το πρώτο byte του response
+  uint32_t retries = 0;
+  uint32_t slowDowns = 0;
+
+  char statusPath[64];
+  char statusBody[256];
+};
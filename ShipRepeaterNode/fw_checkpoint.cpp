@@ -0,0 +1,61 @@
+#include "fw_checkpoint.h"
+
+static const char* FWC_NS = "fw_ckpt";
+static const uint32_t FWC_MAGIC = 0x46574331;  // "FWC1"
+
+struct StoredCheckpoint {
+    uint32_t magic;
+    FirmwareCheckpoint cp;
+};
+
+// NVS keys έχουν όριο 15 χαρακτήρων
+static void fwcKey(const String& sn, char* key, size_t keyLen) {
+    snprintf(key, keyLen, "c%.13s", sn.c_str());
+}
+
+bool fwc_load(const String& sn, FirmwareCheckpoint& out) {
+    char key[16];
+    fwcKey(sn, key, sizeof(key));
+
+    StoredCheckpoint st;
+    size_t got = 0;
+    SdBusGuard sdBus;
+    if (preferences.begin(FWC_NS, true)) {
+        if (preferences.isKey(key)) {
+            got = preferences.getBytes(key, &st, sizeof(st));
+        }
+        preferences.end();
+    }
+    if (got != sizeof(st) || st.magic != FWC_MAGIC) {
+        return false;
+    }
+    out = st.cp;
+    return true;
+}
+
+bool fwc_save(const String& sn, const FirmwareCheckpoint& cp) {
+    char key[16];
+    fwcKey(sn, key, sizeof(key));
+
+    StoredCheckpoint st;
+    st.magic = FWC_MAGIC;
+    st.cp = cp;
+
+    SdBusGuard sdBus;
+    preferences.begin(FWC_NS, false);
+    size_t put = preferences.putBytes(key, &st, sizeof(st));
+    preferences.end();
+    return put == sizeof(st);
+}
+
+void fwc_clear(const String& sn) {
+    char key[16];
+    fwcKey(sn, key, sizeof(key));
+
+    SdBusGuard sdBus;
+    preferences.begin(FWC_NS, false);
+    if (preferences.isKey(key)) {
+        preferences.remove(key);
+    }
+    preferences.end();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "config.h"
+#include <Arduino.h>
+
+// Πρόοδος firmware update ανά sensor SN, στο NVS (επιβιώνει deep sleep / reset).
+// Γράφεται κάθε FWC_SAVE_EVERY records και όταν το job σταματά με σφάλμα.
+#define FWC_SAVE_EVERY 64
+
+struct FirmwareCheckpoint {
+    uint32_t imageHash = 0;     // FNV-1a όλου του .hex
+    uint32_t imageSize = 0;
+    uint32_t records = 0;       // records που έχουν γίνει ack
+    uint32_t lineNo = 0;        // γραμμή αρχείου του τελευταίου acked record
+    uint32_t offset = 0;        // byte offset αμέσως μετά το τελευταίο acked record
+    uint32_t addrOffset = 0;    // αρχή του τελευταίου extended address record (02/04)
+};
+
+bool fwc_load(const String& sn, FirmwareCheckpoint& out);
+bool fwc_save(const String& sn, const FirmwareCheckpoint& cp);
+void fwc_clear(const String& sn);
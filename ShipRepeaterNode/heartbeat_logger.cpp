@@ -0,0 +1,208 @@
+#include "heartbeat_logger.h"
+#include "sensor_http.h"
+#include <time.h>
+
+bool HeartbeatLogger::begin() {
+    if (isOpen) return true;
+    if (!initSdCard()) {
+        Serial.println("[HB-LOG] SD not available, heartbeats will not be logged");
+        return false;
+    }
+    SdBusGuard sdBus;
+    // Όλοι οι φάκελοι μία φορά εδώ, όχι ανά heartbeat
+    if (!sd.exists("/received") && !sd.mkdir("/received")) {
+        Serial.println("[HB-LOG] mkdir(/received) failed");
+        return false;
+    }
+    file = sd.open(STATUS_LOG_PATH, O_RDWR | O_CREAT);
+    if (!file) {
+        Serial.printf("[HB-LOG] Failed to open %s\n", STATUS_LOG_PATH);
+        return false;
+    }
+
+    uint32_t expectedSize = recordsOffset() +
+                            (uint32_t)STATUS_LOG_MAX_SENSORS * STATUS_LOG_SLOTS * sizeof(StatusLogRecord);
+    bool valid = file.fileSize() == expectedSize &&
+                 file.read(&header, sizeof(header)) == (int)sizeof(header) &&
+                 header.magic == STATUS_LOG_MAGIC &&
+                 header.version == STATUS_LOG_VERSION &&
+                 header.recordSize == sizeof(StatusLogRecord) &&
+                 header.slotsPerSensor == STATUS_LOG_SLOTS &&
+                 header.maxSensors == STATUS_LOG_MAX_SENSORS &&
+                 file.read(sensors, sizeof(sensors)) == (int)sizeof(sensors);
+    if (!valid && !create()) {
+        file.close();
+        return false;
+    }
+
+    pendingCount = 0;
+    tableDirty = false;
+    lastFlushMillis = millis();
+    isOpen = true;
+    Serial.printf("[HB-LOG] %s open (seq %lu)\n", STATUS_LOG_PATH, (unsigned long)header.seq);
+    return true;
+}
+
+// Νέο ή παλιάς μορφής αρχείο: γράφεται μία φορά σε πλήρες μέγεθος με μηδενικά,
+// ώστε μετά όλα τα writes να είναι in place.
+bool HeartbeatLogger::create() {
+    Serial.printf("[HB-LOG] Creating %s (%u sensors x %u records)\n", STATUS_LOG_PATH,
+                  (unsigned)STATUS_LOG_MAX_SENSORS, (unsigned)STATUS_LOG_SLOTS);
+    memset(&header, 0, sizeof(header));
+    header.magic = STATUS_LOG_MAGIC;
+    header.version = STATUS_LOG_VERSION;
+    header.recordSize = sizeof(StatusLogRecord);
+    header.slotsPerSensor = STATUS_LOG_SLOTS;
+    header.maxSensors = STATUS_LOG_MAX_SENSORS;
+    memset(sensors, 0, sizeof(sensors));
+
+    if (!file.truncate(0) || !file.seekSet(0)) return false;
+    if (file.write((const uint8_t*)&header, sizeof(header)) != sizeof(header)) return false;
+    if (file.write((const uint8_t*)sensors, sizeof(sensors)) != sizeof(sensors)) return false;
+    uint8_t zero[512];
+    memset(zero, 0, sizeof(zero));
+    uint32_t left = (uint32_t)STATUS_LOG_MAX_SENSORS * STATUS_LOG_SLOTS * sizeof(StatusLogRecord);
+    while (left > 0) {
+        size_t n = min((uint32_t)sizeof(zero), left);
+        if (file.write(zero, n) != n) {
+            Serial.println("[HB-LOG] Failed to create status log");
+            return false;
+        }
+        left -= n;
+    }
+    return file.sync();
+}
+
+void HeartbeatLogger::end() {
+    if (!isOpen) return;
+    SdBusGuard sdBus;
+    flush();
+    file.close();
+    isOpen = false;
+    Serial.println("[HB-LOG] Log file closed");
+}
+
+// SN -> index στον πίνακα. Αν είναι γεμάτος, παίρνει τη θέση του sensor
+// που δεν έχει γράψει εδώ και περισσότερο καιρό.
+int HeartbeatLogger::intern(const char* sn) {
+    int freeIdx = -1;
+    int oldest = 0;
+    for (int i = 0; i < STATUS_LOG_MAX_SENSORS; i++) {
+        if (sensors[i].sn[0] == '\0') {
+            if (freeIdx < 0) freeIdx = i;
+            continue;
+        }
+        if (strncmp(sensors[i].sn, sn, sizeof(sensors[i].sn)) == 0) return i;
+        if (sensors[i].lastSeq < sensors[oldest].lastSeq || sensors[oldest].sn[0] == '\0') oldest = i;
+    }
+    int idx = freeIdx >= 0 ? freeIdx : oldest;
+    if (freeIdx < 0) {
+        Serial.printf("[HB-LOG] Sensor table full, evicting SN=%s\n", sensors[idx].sn);
+    }
+    StatusLogSensor& s = sensors[idx];
+    memset(&s, 0, sizeof(s));
+    strncpy(s.sn, sn, sizeof(s.sn) - 1);
+    s.firstSeq = header.seq + 1;
+    tableDirty = true;
+    return idx;
+}
+
+void HeartbeatLogger::parseStatus(const char* data, StatusLogFields& out) {
+    out = StatusLogFields();
+    char v[32];
+    if (shttp_statusField(data, "BATTERY_VOLTAGE", v, sizeof(v))) {
+        out.batteryMv = (uint16_t)(strtof(v, nullptr) * 1000.0f + 0.5f);
+        out.flags |= STATUS_LOG_HAS_BATTERY;
+    }
+    if (shttp_statusField(data, "FIRMWARE_VERSION", v, sizeof(v))) {
+        const char* p = v;
+        if (strncmp(p, "BL_", 3) == 0) {
+            out.flags |= STATUS_LOG_BOOTLOADER;
+            p += 3;
+        }
+        unsigned a = 0, b = 0, c = 0;
+        if (sscanf(p, "%u.%u.%u", &a, &b, &c) >= 2) {
+            out.firmware = ((a & 0xFFFF) << 16) | ((b & 0xFF) << 8) | (c & 0xFF);
+            out.flags |= STATUS_LOG_HAS_FW;
+        }
+    }
+    if (shttp_statusField(data, "WIFI_SIGNAL", v, sizeof(v))) {
+        out.wifiSignal = (int16_t)strtol(v, nullptr, 10);
+        out.flags |= STATUS_LOG_HAS_WIFI;
+    }
+    if (shttp_statusField(data, "TEMPERATURE", v, sizeof(v))) {
+        float t = strtof(v, nullptr);
+        out.tempDeciC = (int16_t)(t * 10.0f + (t < 0 ? -0.5f : 0.5f));
+        out.flags |= STATUS_LOG_HAS_TEMP;
+    }
+}
+
+void HeartbeatLogger::log(const char* sn, uint32_t ip, const StatusLogFields* status) {
+    if (!isOpen || !sn || sn[0] == '\0') return;
+    if (pendingCount == HB_LOG_PENDING) flush();
+
+    int idx = intern(sn);
+    StatusLogSensor& s = sensors[idx];
+    StatusLogRecord& rec = pending[pendingCount];
+    memset(&rec, 0, sizeof(rec));
+    rec.seq = ++header.seq;
+    rec.uptimeMs = millis();
+    rec.sensor = (uint16_t)idx;
+    rec.kind = status ? STATUS_LOG_STATUS : STATUS_LOG_HEARTBEAT;
+
+    time_t now;
+    time(&now);
+    struct tm* timeinfo = localtime(&now);
+    if (timeinfo && timeinfo->tm_year > (2023 - 1900)) {
+        rec.epoch = (uint32_t)now;
+        rec.flags |= STATUS_LOG_TIME_VALID;
+    }
+
+    memcpy(rec.ip, &ip, sizeof(rec.ip));  // IPAddress: a.b.c.d στη σειρά της μνήμης
+    if (status) {
+        rec.firmware = status->firmware;
+        rec.batteryMv = status->batteryMv;
+        rec.wifiSignal = status->wifiSignal;
+        rec.tempDeciC = status->tempDeciC;
+        rec.flags |= status->flags;
+    }
+
+    pendingPos[pendingCount] = (uint32_t)idx * STATUS_LOG_SLOTS + s.count % STATUS_LOG_SLOTS;
+    pendingCount++;
+    s.count++;
+    s.lastSeq = rec.seq;
+    tableDirty = true;
+}
+
+void HeartbeatLogger::flush() {
+    if (!isOpen) return;
+    lastFlushMillis = millis();
+    if (pendingCount == 0 && !tableDirty) return;
+
+    // Και από το log() όταν γεμίσει το pending, όχι μόνο από το poll()
+    SdBusGuard sdBus;
+    bool ok = true;
+    for (uint16_t i = 0; i < pendingCount && ok; i++) {
+        ok = file.seekSet(recordsOffset() + pendingPos[i] * sizeof(StatusLogRecord)) &&
+             file.write((const uint8_t*)&pending[i], sizeof(StatusLogRecord)) == sizeof(StatusLogRecord);
+    }
+    // Header + πίνακας μετά τα records: αν κοπεί το ρεύμα στη μέση, ο decoder
+    // βλέπει απλώς λιγότερα records (τα νέα slots δεν μετράνε ακόμα στο count)
+    if (ok && tableDirty) {
+        ok = file.seekSet(0) &&
+             file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+             file.write((const uint8_t*)sensors, sizeof(sensors)) == sizeof(sensors);
+    }
+    if (!ok || !file.sync()) {
+        Serial.printf("[HB-LOG] Write to %s failed, %u records lost\n", STATUS_LOG_PATH,
+                      (unsigned)pendingCount);
+    }
+    pendingCount = 0;
+    tableDirty = false;
+}
+
+void HeartbeatLogger::poll() {
+    if (!isOpen) return;
+    if (millis() - lastFlushMillis < HB_LOG_FLUSH_MS) return;
+    flush();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "config.h"
+#include "status_log_format.h"
+#include <Arduino.h>
+
+// Log των heartbeats/status του collector AP στο /received/status.bin
+// (fixed-size records, ring ανά sensor, βλ. status_log_format.h).
+// Το αρχείο ανοίγει μία φορά ανά AP session (begin) και μένει ανοιχτό.
+// Κάθε heartbeat είναι ένα record 32 bytes σε buffer RAM· ο buffer γράφεται
+// in place στην SD όταν γεμίσει, κάθε HB_LOG_FLUSH_MS (poll) και στο end()
+// πριν το sleep. Το αρχείο έχει σταθερό μέγεθος, οπότε ένα flush δεν αλλάζει
+// FAT ή dir entry.
+//
+// Εργαλείο για CSV στον υπολογιστή: tools/status_log_dump.cpp
+#define STATUS_LOG_PATH "/received/status.bin"
+
+// Τα πεδία του STATUS που κρατάει το record, parsed στον handler ώστε στο
+// hbBuffer να περνάνε λίγα bytes αντί για όλο το body (έως STATUS_MAX_BODY)
+struct StatusLogFields {
+    uint32_t firmware = 0;
+    uint16_t batteryMv = 0;
+    int16_t wifiSignal = 0;
+    int16_t tempDeciC = 0;
+    uint8_t flags = 0;         // STATUS_LOG_HAS_* / STATUS_LOG_BOOTLOADER
+};
+
+class HeartbeatLogger {
+public:
+    bool begin();   // mkdir + open (+ δημιουργία αρχείου), μία φορά ανά AP session
+    void end();     // flush + close (stopAPMode / deep sleep)
+    bool active() const { return isOpen; }
+
+    // Ένα record. Με status (STATUS_LOG_STATUS) κρατάει battery/fw/wifi/temp.
+    void log(const char* sn, uint32_t ip, const StatusLogFields* status = nullptr);
+
+    // Το "data" του STATUS body: MODE=...,S/N=...,BATTERY_VOLTAGE=3.29,...
+    static void parseStatus(const char* data, StatusLogFields& out);
+
+    // Γράφει ό,τι έχει μείνει στον buffer αν πέρασε HB_LOG_FLUSH_MS
+    void poll();
+    void flush();
+
+private:
+    static uint32_t recordsOffset() {
+        return sizeof(StatusLogHeader) + STATUS_LOG_MAX_SENSORS * sizeof(StatusLogSensor);
+    }
+    bool create();
+    int intern(const char* sn);
+
+    FsFile file;
+    StatusLogHeader header;
+    StatusLogSensor sensors[STATUS_LOG_MAX_SENSORS];
+    StatusLogRecord pending[HB_LOG_PENDING];
+    uint32_t pendingPos[HB_LOG_PENDING];   // slot στο αρχείο (από recordsOffset)
+    uint16_t pendingCount = 0;
+    bool tableDirty = false;
+    uint32_t lastFlushMillis = 0;
+    bool isOpen = false;
+};
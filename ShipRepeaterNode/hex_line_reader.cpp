@@ -0,0 +1,358 @@
+#include "hex_line_reader.h"
+
+extern SdFat sd;
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// ------------------------------------------
+// HexImageSource: κοινό, cached άνοιγμα ενός .hex
+// ------------------------------------------
+static HexImageSource g_sources[HEX_SHARED_IMAGES];
+uint32_t HexImageSource::hits = 0;
+uint32_t HexImageSource::misses = 0;
+
+HexImageSource* HexImageSource::acquire(const char* path) {
+    HexImageSource* freeSlot = nullptr;
+    for (auto& s : g_sources) {
+        if (s.refs > 0 && s.filePath == path) {
+            s.refs++;
+            return &s;
+        }
+        // Προτιμάμε το slot που έχει ήδη το hash αυτού του image
+        if (s.refs == 0 && (!freeSlot || s.hashPath == path)) freeSlot = &s;
+    }
+    if (!freeSlot) {
+        Serial.printf("[HEX] ERROR: no free image slot for %s\n", path);
+        return nullptr;
+    }
+
+    HexImageSource& s = *freeSlot;
+    SdBusGuard sdBus;
+    s.file = sd.open(path, O_RDONLY);
+    if (!s.file) {
+        return nullptr;
+    }
+    s.filePath = path;
+    s.totalSize = s.file.fileSize();
+    s.refs = 1;
+    s.useClock = 0;
+    // Το hash μένει από προηγούμενο άνοιγμα αν το αρχείο δεν άλλαξε (μέγεθος + mtime)
+    uint16_t mdate = 0, mtime = 0;
+    s.file.getModifyDateTime(&mdate, &mtime);
+    if (!s.hashed || s.hashPath != path || s.hashSize != (uint32_t)s.totalSize ||
+        s.hashDate != mdate || s.hashTime != mtime) {
+        s.hashed = false;
+        s.hashPath = path;
+        s.hashDate = mdate;
+        s.hashTime = mtime;
+    }
+    for (auto& b : s.cache) b.valid = false;
+    return &s;
+}
+
+void HexImageSource::release(HexImageSource* src) {
+    if (!src || src->refs <= 0) return;
+    if (--src->refs == 0) {
+        SdBusGuard sdBus;
+        src->file.close();
+        src->filePath = "";
+    }
+}
+
+int HexImageSource::readBlock(uint32_t idx, uint8_t* dst) {
+    useClock++;
+    Block* victim = &cache[0];
+    for (auto& b : cache) {
+        if (b.valid && b.idx == idx) {
+            b.lastUse = useClock;
+            memcpy(dst, b.data, b.len);
+            hits++;
+            return b.len;
+        }
+        if (!b.valid || (victim->valid && b.lastUse < victim->lastUse)) {
+            victim = &b;
+        }
+    }
+
+    misses++;
+    int rd;
+    {
+        SdBusGuard sdBus;
+        if (!file.seekSet((uint64_t)idx * HEX_READ_BLOCK_SIZE)) {
+            return -1;
+        }
+        rd = file.read(victim->data, HEX_READ_BLOCK_SIZE);
+    }
+    if (rd <= 0) {
+        return rd;
+    }
+    victim->idx = idx;
+    victim->len = (uint16_t)rd;
+    victim->lastUse = useClock;
+    victim->valid = true;
+    memcpy(dst, victim->data, rd);
+    return rd;
+}
+
+bool HexImageSource::imageHash(uint32_t& hashOut, uint32_t& sizeOut) {
+    if (!hashed) {
+        if (!HexLineReader::hashFile(filePath.c_str(), hash, hashSize)) {
+            return false;
+        }
+        hashed = hashSize == (uint32_t)totalSize;  // άλλαξε ενώ το διαβάζαμε: όχι cache
+    }
+    hashOut = hash;
+    sizeOut = hashSize;
+    return true;
+}
+
+// ------------------------------------------
+// HexLineReader
+// ------------------------------------------
+bool HexLineReader::open(const char* path) {
+    close();
+    src = HexImageSource::acquire(path);
+    if (!src) {
+        return false;
+    }
+    totalSize = src->size();
+    blockLen = 0;
+    blockPos = 0;
+    fetchPos = 0;
+    requestLen = 0;
+    request[0] = '\0';
+    recType = 0;
+    lineNo = 0;
+    records = 0;
+    consumed = 0;
+    recStart = 0;
+    lastAddrOffset = 0;
+    seenEof = false;
+    return true;
+}
+
+bool HexLineReader::seekTo(uint64_t offset, uint32_t recordsBefore, uint32_t lineNoBefore, uint64_t addrOffset) {
+    if (!src || offset > totalSize) {
+        return false;
+    }
+    blockLen = 0;
+    blockPos = 0;
+    fetchPos = offset;
+    consumed = offset;
+    recStart = offset;
+    records = recordsBefore;
+    lineNo = lineNoBefore;
+    lastAddrOffset = addrOffset;
+    seenEof = false;
+    return true;
+}
+
+void HexLineReader::close() {
+    if (src) {
+        HexImageSource::release(src);
+        src = nullptr;
+    }
+}
+
+bool HexLineReader::fillBlock() {
+    uint32_t idx = (uint32_t)(fetchPos / HEX_READ_BLOCK_SIZE);
+    size_t skip = (size_t)(fetchPos % HEX_READ_BLOCK_SIZE);
+    int rd = src->readBlock(idx, block);
+    if (rd <= 0 || (size_t)rd <= skip) {
+        blockLen = 0;
+        blockPos = 0;
+        return false;
+    }
+    blockLen = (size_t)rd;
+    blockPos = skip;
+    fetchPos = (uint64_t)(idx + 1) * HEX_READ_BLOCK_SIZE;
+    return true;
+}
+
+// Μία γραμμή από το block buffer στο line[] (χωρίς CR/LF).
+// Αν η γραμμή ξεπερνά το HEX_MAX_LINE_CHARS, καταναλώνεται μέχρι το '\n' και tooLong=true.
+bool HexLineReader::readLine(size_t& lenOut, bool& tooLong) {
+    size_t len = 0;
+    bool gotAny = false;
+    tooLong = false;
+
+    while (true) {
+        if (blockPos >= blockLen && !fillBlock()) {
+            break;
+        }
+        gotAny = true;
+        uint8_t c = block[blockPos++];
+        consumed++;
+        if (c == '\n') {
+            break;
+        }
+        if (c == '\r') {
+            continue;
+        }
+        if (len < HEX_MAX_LINE_CHARS) {
+            line[len++] = (char)c;
+        } else {
+            tooLong = true;
+        }
+    }
+
+    line[len] = '\0';
+    lenOut = len;
+    if (gotAny) {
+        lineNo++;
+    }
+    return gotAny;
+}
+
+HexReadResult HexLineReader::validateAndEncode(size_t len) {
+    // ':' + LL AAAA TT CC = 11 chars ελάχιστο, ζυγός αριθμός hex digits
+    if (len < 11 || ((len - 1) & 1) != 0) {
+        return HEX_READ_BAD_FORMAT;
+    }
+
+    const size_t prefixLen = sizeof(HEX_REQUEST_PREFIX) - 1;
+    const size_t suffixLen = sizeof(HEX_REQUEST_SUFFIX) - 1;
+    memcpy(request, HEX_REQUEST_PREFIX, prefixLen);
+    char* out = request + prefixLen;
+
+    // Replace ':' with '.' per Diagnonic requirement
+    *out++ = '.';
+
+    uint8_t sum = 0;
+    uint8_t count = 0;
+    size_t nBytes = (len - 1) / 2;
+    for (size_t i = 0; i < nBytes; ++i) {
+        char hi = line[1 + 2 * i];
+        char lo = line[2 + 2 * i];
+        int h = hexNibble(hi);
+        int l = hexNibble(lo);
+        if (h < 0 || l < 0) {
+            return HEX_READ_BAD_FORMAT;
+        }
+        uint8_t b = (uint8_t)((h << 4) | l);
+        if (i == 0) count = b;
+        if (i == 3) recType = b;
+        sum += b;
+        *out++ = hi;
+        *out++ = lo;
+    }
+
+    // LL + AAAA + TT + data + CC
+    if (nBytes != (size_t)count + 5) {
+        return HEX_READ_BAD_FORMAT;
+    }
+    if (sum != 0) {
+        return HEX_READ_BAD_CHECKSUM;
+    }
+    if (recType > 0x05) {
+        return HEX_READ_BAD_TYPE;
+    }
+
+    memcpy(out, HEX_REQUEST_SUFFIX, suffixLen);
+    out += suffixLen;
+    *out = '\0';
+    requestLen = (size_t)(out - request);
+    return HEX_READ_OK;
+}
+
+HexReadResult HexLineReader::next() {
+    if (!src) {
+        return HEX_READ_IO_ERROR;
+    }
+    if (seenEof) {
+        return HEX_READ_EOF;
+    }
+
+    size_t len = 0;
+    bool tooLong = false;
+    while (true) {
+        uint64_t lineStart = consumed;
+        if (!readLine(len, tooLong)) break;
+        // trim leading/trailing whitespace
+        size_t start = 0;
+        while (start < len && (line[start] == ' ' || line[start] == '\t')) start++;
+        while (len > start && (line[len - 1] == ' ' || line[len - 1] == '\t')) len--;
+        if (start > 0) {
+            memmove(line, line + start, len - start);
+            len -= start;
+        }
+        line[len] = '\0';
+
+        if (len == 0 && !tooLong) continue;
+        if (line[0] != ':') {
+            Serial.printf("[HEX] WARNING: skipping invalid line %u\n", (unsigned)lineNo);
+            continue;
+        }
+        if (tooLong) {
+            return HEX_READ_BAD_FORMAT;
+        }
+
+        HexReadResult r = validateAndEncode(len);
+        if (r != HEX_READ_OK) {
+            return r;
+        }
+        records++;
+        recStart = lineStart;
+        if (recType == 0x02 || recType == 0x04) {
+            lastAddrOffset = lineStart;
+        }
+        if (recType == 0x01) {
+            // Το EOF record στέλνεται κι αυτό στον sensor, μετά σταματάμε
+            seenEof = true;
+        }
+        return HEX_READ_OK;
+    }
+    return HEX_READ_EOF;
+}
+
+// Το SD bus lock ανά block, ώστε ένα μεγάλο image να μην κρατάει τους άλλους
+bool HexLineReader::hashFile(const char* path, uint32_t& hashOut, uint32_t& sizeOut) {
+    FsFile f;
+    {
+        SdBusGuard sdBus;
+        f = sd.open(path, O_RDONLY);
+    }
+    if (!f) {
+        return false;
+    }
+    uint8_t buf[HEX_READ_BLOCK_SIZE];
+    uint32_t h = 2166136261UL;
+    uint32_t total = 0;
+    for (;;) {
+        int rd;
+        {
+            SdBusGuard sdBus;
+            rd = f.read(buf, sizeof(buf));
+        }
+        if (rd <= 0) break;
+        for (int i = 0; i < rd; ++i) {
+            h ^= buf[i];
+            h *= 16777619UL;
+        }
+        total += (uint32_t)rd;
+    }
+    {
+        SdBusGuard sdBus;
+        f.close();
+    }
+    hashOut = h;
+    sizeOut = total;
+    return true;
+}
+
+const char* HexLineReader::resultToString(HexReadResult r) {
+    switch (r) {
+        case HEX_READ_OK:           return "OK";
+        case HEX_READ_EOF:          return "EOF";
+        case HEX_READ_BAD_FORMAT:   return "bad format";
+        case HEX_READ_BAD_CHECKSUM: return "bad checksum";
+        case HEX_READ_BAD_TYPE:     return "bad record type";
+        case HEX_READ_IO_ERROR:     return "I/O error";
+    }
+    return "?";
+}
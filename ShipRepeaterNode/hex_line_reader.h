@@ -0,0 +1,134 @@
+#pragma once
+
+#include "config.h"
+#include <Arduino.h>
+
+// Intel HEX: ':' + 2*(len + addr(2) + type + data(255) + checksum) = 521 chars max
+#define HEX_MAX_LINE_CHARS   521
+#define HEX_READ_BLOCK_SIZE  512
+
+// Κοινά images ανοιχτά ταυτόχρονα και cached blocks ανά image
+#define HEX_SHARED_IMAGES    2
+#define HEX_CACHE_BLOCKS     4
+
+// Σταθερό prefix/suffix του FIRMWARE_UPDATE request (Diagnonic)
+#define HEX_REQUEST_PREFIX   "/api?command=FIRMWARE_UPDATE&hex="
+#define HEX_REQUEST_SUFFIX   "&d=0"
+#define HEX_REQUEST_MAX_LEN  (sizeof(HEX_REQUEST_PREFIX) - 1 + HEX_MAX_LINE_CHARS + sizeof(HEX_REQUEST_SUFFIX))
+
+enum HexReadResult {
+    HEX_READ_OK,          // έγκυρο record, το request είναι έτοιμο
+    HEX_READ_EOF,         // τέλος αρχείου ή EOF record (type 01)
+    HEX_READ_BAD_FORMAT,  // μη-hex χαρακτήρες, λάθος μήκος, πολύ μεγάλη γραμμή
+    HEX_READ_BAD_CHECKSUM,
+    HEX_READ_BAD_TYPE,    // record type εκτός 00..05
+    HEX_READ_IO_ERROR
+};
+
+// Ένα .hex ανοιχτό μία φορά για όλους τους readers που το στέλνουν ταυτόχρονα.
+// Κρατά τα πιο πρόσφατα blocks σε μικρό LRU cache, οπότε sensors που κάνουν
+// update με το ίδιο image στο ίδιο window μοιράζονται τα SD reads.
+class HexImageSource {
+public:
+    static HexImageSource* acquire(const char* path);
+    static void release(HexImageSource* src);
+
+    // Αντιγράφει το block idx στο dst, από cache ή από την SD
+    int readBlock(uint32_t idx, uint8_t* dst);
+
+    // FNV-1a + μέγεθος, υπολογίζεται μία φορά ανά image: κρατιέται και μετά
+    // το release, όσο το αρχείο έχει το ίδιο μέγεθος και mtime
+    bool imageHash(uint32_t& hashOut, uint32_t& sizeOut);
+
+    uint64_t size() const { return totalSize; }
+    const String& path() const { return filePath; }
+
+    static uint32_t cacheHits() { return hits; }
+    static uint32_t cacheMisses() { return misses; }
+
+private:
+    struct Block {
+        uint32_t idx;
+        uint32_t lastUse;
+        uint16_t len;
+        bool valid;
+        uint8_t data[HEX_READ_BLOCK_SIZE];
+    };
+
+    FsFile file;
+    String filePath;
+    uint64_t totalSize = 0;
+    int refs = 0;
+    uint32_t useClock = 0;
+    bool hashed = false;
+    String hashPath;        // το image του hash (μένει μετά το release)
+    uint32_t hash = 0;
+    uint32_t hashSize = 0;
+    uint16_t hashDate = 0;  // mtime του αρχείου όταν έγινε το hash
+    uint16_t hashTime = 0;
+    Block cache[HEX_CACHE_BLOCKS];
+
+    static uint32_t hits;
+    static uint32_t misses;
+};
+
+// Streaming Intel HEX reader.
+// Διαβάζει το αρχείο σε blocks από την SD, επικυρώνει κάθε record on the fly
+// και γράφει το FIRMWARE_UPDATE path (':' -> '.') σε ένα επαναχρησιμοποιούμενο buffer.
+// Η μνήμη είναι σταθερή (~1.7 KB) ανεξάρτητα από το μέγεθος του image.
+class HexLineReader {
+public:
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return src != nullptr; }
+    HexImageSource* source() const { return src; }
+
+    // Διαβάζει το επόμενο record. Κενές γραμμές και γραμμές χωρίς ':' παραλείπονται.
+    HexReadResult next();
+
+    // Συνέχεια από checkpoint: offset αμέσως μετά το τελευταίο acked record.
+    // addrOffset = αρχή του τελευταίου extended address record (02/04) πριν από αυτό.
+    bool seekTo(uint64_t offset, uint32_t recordsBefore, uint32_t lineNoBefore, uint64_t addrOffset);
+
+    // Valid μόνο μετά από HEX_READ_OK, μέχρι το επόμενο next()
+    const char* requestPath() const { return request; }
+    size_t requestLength() const { return requestLen; }
+    uint8_t recordType() const { return recType; }
+
+    uint32_t lineNumber() const { return lineNo; }     // γραμμή στο αρχείο (1-based)
+    uint32_t recordIndex() const { return records ? records - 1 : 0; } // τρέχον record (0-based)
+    uint32_t recordCount() const { return records; }
+    uint64_t fileSize() const { return totalSize; }
+    uint64_t bytesConsumed() const { return consumed; }
+    uint64_t recordStartOffset() const { return recStart; }
+    uint64_t lastAddressRecordOffset() const { return lastAddrOffset; }
+
+    // FNV-1a πάνω σε όλο το αρχείο, για να ξέρουμε αν το image άλλαξε
+    static bool hashFile(const char* path, uint32_t& hashOut, uint32_t& sizeOut);
+
+    static const char* resultToString(HexReadResult r);
+
+private:
+    bool fillBlock();
+    bool readLine(size_t& lenOut, bool& tooLong);
+    HexReadResult validateAndEncode(size_t len);
+
+    HexImageSource* src = nullptr;
+    uint8_t block[HEX_READ_BLOCK_SIZE];
+    size_t blockLen = 0;
+    size_t blockPos = 0;
+    uint64_t fetchPos = 0;  // offset του επόμενου block που θα ζητηθεί
+
+    char line[HEX_MAX_LINE_CHARS + 1];
+    char request[HEX_REQUEST_MAX_LEN + 1];
+    size_t requestLen = 0;
+
+    uint8_t recType = 0;
+    uint32_t lineNo = 0;
+    uint32_t records = 0;
+    uint64_t totalSize = 0;
+    uint64_t consumed = 0;
+    uint64_t recStart = 0;
+    uint64_t lastAddrOffset = 0;
+    bool seenEof = false;
+};
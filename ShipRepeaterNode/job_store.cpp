@@ -0,0 +1,615 @@
+#include "job_store.h"
+
+extern SdFat sd;
+extern bool initSdCard();
+
+static const int JOB_SCAN_MAX_DEPTH = 16;
+static const size_t JOB_SCAN_TOKEN = 32;
+
+// ------------------------------------------
+// Streaming scanner
+// ------------------------------------------
+// Περνάει το αρχείο byte-byte (blocks των 512) κρατώντας μόνο το nesting
+// και το τελευταίο key. Βρίσκει το jobs array (root array ή "jobs" στο root
+// object) και για κάθε object μέσα του δίνει offset/length και το "sn"
+// (string ή αριθμός) χωρίς να φορτώσει το record.
+bool JobStore::scan(const char* path, RecordFn fn, void* ctx, uint32_t* hashOut)
+{
+    FsFile f = sd.open(path, O_RDONLY);
+    if (!f) {
+        return false;
+    }
+
+    char stack[JOB_SCAN_MAX_DEPTH];
+    int depth = 0;
+    bool inStr = false;
+    bool esc = false;
+    bool expectKey = false;
+    int jobsDepth = -1;   // depth του jobs array (μετά το push)
+    int recDepth = -1;    // depth του τρέχοντος record object
+    uint32_t recStart = 0;
+
+    char tok[JOB_SCAN_TOKEN + 1];
+    size_t tokLen = 0;
+    bool tokIsKey = false;
+    char lastKey[8] = "";
+    char sn[JOB_SCAN_TOKEN + 1] = "";
+    size_t snLen = 0;
+    bool inBareSn = false;  // αριθμητικό "sn": 324269
+
+    uint8_t buf[512];
+    uint32_t pos = 0;
+    bool ok = true;
+    bool sawRoot = false;
+    uint32_t h = 2166136261UL;
+    int rd;
+    while (ok && (rd = f.read(buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < rd; ++i, ++pos) {
+            char c = (char)buf[i];
+            h ^= buf[i];
+            h *= 16777619UL;
+
+            if (inStr) {
+                if (esc) {
+                    esc = false;
+                } else if (c == '\\') {
+                    esc = true;
+                    continue;
+                } else if (c == '"') {
+                    inStr = false;
+                    tok[tokLen] = '\0';
+                    if (tokIsKey) {
+                        strncpy(lastKey, tokLen < sizeof(lastKey) ? tok : "", sizeof(lastKey) - 1);
+                        lastKey[sizeof(lastKey) - 1] = '\0';
+                    } else if (depth == recDepth && strcmp(lastKey, "sn") == 0) {
+                        memcpy(sn, tok, tokLen + 1);
+                        snLen = tokLen;
+                    }
+                    continue;
+                }
+                if (tokLen < JOB_SCAN_TOKEN) tok[tokLen++] = c;
+                continue;
+            }
+
+            if (inBareSn) {
+                if ((c >= '0' && c <= '9') || c == '-' || c == '.' ||
+                    (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                    if (snLen < JOB_SCAN_TOKEN) sn[snLen++] = c;
+                    sn[snLen] = '\0';
+                    continue;
+                }
+                inBareSn = false;
+            }
+
+            switch (c) {
+            case '"':
+                inStr = true;
+                tokLen = 0;
+                tokIsKey = expectKey;
+                break;
+            case '{':
+            case '[':
+                if (depth >= JOB_SCAN_MAX_DEPTH) {
+                    ok = false;
+                    break;
+                }
+                if (depth == 0) {
+                    sawRoot = true;
+                    if (c == '[') jobsDepth = 1;
+                } else if (c == '[' && depth == 1 && stack[0] == '{' &&
+                           strcmp(lastKey, "jobs") == 0) {
+                    jobsDepth = 2;
+                } else if (c == '{' && depth == jobsDepth && recDepth < 0) {
+                    recStart = pos;
+                    recDepth = depth + 1;
+                    sn[0] = '\0';
+                    snLen = 0;
+                }
+                stack[depth++] = c;
+                expectKey = (c == '{');
+                lastKey[0] = '\0';
+                break;
+            case '}':
+            case ']':
+                if (depth == 0) {
+                    ok = false;
+                    break;
+                }
+                if (c == '}' && depth == recDepth) {
+                    fn(sn, recStart, pos + 1 - recStart, ctx);
+                    recDepth = -1;
+                }
+                if (depth == jobsDepth) {
+                    jobsDepth = -1;
+                }
+                depth--;
+                expectKey = false;
+                break;
+            case ',':
+                expectKey = depth > 0 && stack[depth - 1] == '{';
+                break;
+            case ':':
+                expectKey = false;
+                break;
+            case ' ': case '\t': case '\r': case '\n':
+                break;
+            default:
+                // Αριθμός / literal ως τιμή του "sn"
+                if (depth == recDepth && !expectKey && strcmp(lastKey, "sn") == 0 && snLen == 0) {
+                    inBareSn = true;
+                    sn[snLen++] = c;
+                    sn[snLen] = '\0';
+                }
+                break;
+            }
+        }
+    }
+    f.close();
+
+    if (!ok || !sawRoot || depth != 0 || inStr) {
+        Serial.printf("[JOBSTORE] Invalid JSON in %s near byte %lu\n", path, (unsigned long)pos);
+        return false;
+    }
+    if (hashOut) *hashOut = h;
+    return true;
+}
+
+// ------------------------------------------
+// Index
+// ------------------------------------------
+uint32_t JobStore::hashSn(const char* sn)
+{
+    uint32_t h = 2166136261UL;
+    while (*sn) {
+        h ^= (uint8_t)*sn++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+void JobStore::clear()
+{
+    free(entries);
+    entries = nullptr;
+    capacity = 0;
+    fileJobs = 0;
+    filePath = "";
+    logPath = "";
+    isLoaded = false;
+    live = 0;
+    used = 0;
+    tombstones = 0;
+    fileHash = 0;
+    fileSize = 0;
+    overflowed = false;
+}
+
+void JobStore::onCountRecord(const char* sn, uint32_t, uint32_t, void* ctx)
+{
+    if (sn[0] != '\0') (*(uint32_t*)ctx)++;
+}
+
+void JobStore::onIndexRecord(const char* sn, uint32_t offset, uint32_t len, void* ctx)
+{
+    JobStore* self = (JobStore*)ctx;
+    if (sn[0] == '\0') {
+        Serial.printf("[JOBSTORE] WARNING: job without sn at byte %lu, ignored\n", (unsigned long)offset);
+        return;
+    }
+    if (len > JOB_RECORD_DOC_SIZE * 4 || offset >= (1UL << 30)) {
+        Serial.printf("[JOBSTORE] WARNING: job for SN=%s at byte %lu too large (%lu bytes), ignored\n",
+                      sn, (unsigned long)offset, (unsigned long)len);
+        return;
+    }
+    // Load factor <= 75%: τα probe chains μένουν σύντομα και υπάρχει πάντα EMPTY
+    if ((self->used + 1) * 4 > self->capacity * 3) {
+        self->overflowed = true;
+        return;
+    }
+
+    uint32_t h = hashSn(sn);
+    uint32_t i = h % self->capacity;
+    while (self->entries[i].state != ENTRY_EMPTY) {
+        i = (i + 1) % self->capacity;
+    }
+    Entry& e = self->entries[i];
+    e.hash = h;
+    e.offset = offset;
+    e.state = ENTRY_LIVE;
+    self->used++;
+    self->live++;
+}
+
+bool JobStore::load(const char* path)
+{
+    clear();
+    if (!initSdCard()) return false;
+
+    // Compaction που διακόπηκε ανάμεσα στο remove και το rename
+    String tmp = String(path) + ".tmp";
+    if (!sd.exists(path) && sd.exists(tmp.c_str())) {
+        Serial.printf("[JOBSTORE] Recovering %s from interrupted compaction\n", path);
+        sd.rename(tmp.c_str(), path);
+    }
+    if (!sd.exists(path)) return false;
+
+    filePath = path;
+    logPath = String(path) + ".done";
+    unsigned long t0 = millis();
+
+    // Πρώτο πέρασμα: πόσα jobs, ώστε το index να έχει το μέγεθος του αρχείου
+    if (!scan(path, onCountRecord, &fileJobs)) {
+        clear();
+        return false;
+    }
+    // Όριο JOB_STORE_INDEX_BYTES· αν ούτε αυτό χωράει στο heap, μικρότερο index
+    // και τα υπόλοιπα jobs περιμένουν επόμενο session
+    const uint32_t maxSlots = JOB_STORE_INDEX_BYTES / sizeof(Entry);
+    capacity = min(max((uint32_t)16, fileJobs + fileJobs / 3 + 1), maxSlots);
+    entries = (Entry*)calloc(capacity, sizeof(Entry));
+    while (!entries && capacity > 16) {
+        capacity /= 2;
+        entries = (Entry*)calloc(capacity, sizeof(Entry));
+    }
+    if (!entries) {
+        Serial.printf("[JOBSTORE] ERROR: no memory for %lu-slot index of %s\n",
+                      (unsigned long)capacity, path);
+        uint32_t keep = fileJobs;
+        clear();
+        fileJobs = keep;
+        return false;
+    }
+
+    if (!scan(path, onIndexRecord, this, &fileHash)) {
+        clear();
+        return false;
+    }
+    {
+        FsFile f = sd.open(path, O_RDONLY);
+        fileSize = f ? (uint32_t)f.fileSize() : 0;
+        f.close();
+    }
+    isLoaded = true;
+    applyLog();
+    if (overflowed) {
+        Serial.printf("[JOBSTORE] WARNING: %s has %lu jobs, indexed %lu (%lu-byte index); "
+                      "%lu wait for a later session\n",
+                      path, (unsigned long)fileJobs, (unsigned long)used,
+                      (unsigned long)(capacity * sizeof(Entry)), (unsigned long)(fileJobs - used));
+    }
+    Serial.printf("[JOBSTORE] Indexed %lu jobs from %s in %lu ms (%lu already done, %lu-slot index, %lu bytes)\n",
+                  (unsigned long)live, path, millis() - t0, (unsigned long)tombstones,
+                  (unsigned long)capacity, (unsigned long)(capacity * sizeof(Entry)));
+    return true;
+}
+
+// ------------------------------------------
+// Completion log (tombstones)
+// ------------------------------------------
+// Format:
+//   #<file hash hex> <file size>
+//   <offset>,<sn>
+// Μισογραμμένη τελευταία γραμμή (power loss) αγνοείται.
+void JobStore::applyLog()
+{
+    if (!sd.exists(logPath.c_str())) return;
+    FsFile f = sd.open(logPath.c_str(), O_RDONLY);
+    if (!f) return;
+
+    char line[64];
+    size_t len = 0;
+    bool header = true;
+    bool stale = false;
+    int c;
+    while (!stale && (c = f.read()) >= 0) {
+        if (c != '\n') {
+            if (len < sizeof(line) - 1) line[len++] = (char)c;
+            continue;
+        }
+        line[len] = '\0';
+        len = 0;
+
+        if (header) {
+            header = false;
+            unsigned long h = 0, sz = 0;
+            if (sscanf(line, "#%lx %lu", &h, &sz) != 2 ||
+                (uint32_t)h != fileHash || (uint32_t)sz != fileSize) {
+                stale = true;
+            }
+            continue;
+        }
+
+        char* comma = strchr(line, ',');
+        if (!comma) continue;
+        *comma = '\0';
+        uint32_t offset = (uint32_t)strtoul(line, nullptr, 10);
+        int i = findByOffset(hashSn(comma + 1), offset);
+        if (i >= 0 && entries[i].state == ENTRY_LIVE) {
+            entries[i].state = ENTRY_REMOVED;
+            live--;
+            tombstones++;
+        }
+    }
+    f.close();
+
+    if (stale) {
+        // Το αρχείο άλλαξε (νέο από root): τα παλιά tombstones δεν ισχύουν
+        Serial.printf("[JOBSTORE] %s does not match %s, discarded\n",
+                      logPath.c_str(), filePath.c_str());
+        sd.remove(logPath.c_str());
+    }
+}
+
+int JobStore::candidates(const String& sn, int* out, int maxOut) const
+{
+    if (!isLoaded) return 0;
+    uint32_t h = hashSn(sn.c_str());
+    uint32_t i = h % capacity;
+    int n = 0;
+    // Ίδιο SN => ίδιο probe chain, με τη σειρά που μπήκαν (σειρά αρχείου)
+    while (entries[i].state != ENTRY_EMPTY && n < maxOut) {
+        if (entries[i].state == ENTRY_LIVE && entries[i].hash == h) {
+            out[n++] = (int)i;
+        }
+        i = (i + 1) % capacity;
+    }
+    return n;
+}
+
+bool JobStore::loadJob(int idx, const String& sn, JsonDocument& doc)
+{
+    if (!isLoaded || idx < 0 || idx >= (int)capacity) return false;
+    const Entry& e = entries[idx];
+    if (e.state != ENTRY_LIVE) return false;
+
+    FsFile f = sd.open(filePath.c_str(), O_RDONLY);
+    if (!f) return false;
+    if (!f.seekSet(e.offset)) {
+        f.close();
+        return false;
+    }
+    // Το deserializeJson σταματά στο τέλος του object, δεν διαβάζει το υπόλοιπο αρχείο
+    DeserializationError err = deserializeJson(doc, f);
+    f.close();
+    if (err) {
+        Serial.printf("[JOBSTORE] Cannot load job at byte %lu of %s: %s\n",
+                      (unsigned long)e.offset, filePath.c_str(), err.c_str());
+        return false;
+    }
+    return doc["sn"].as<String>() == sn;
+}
+
+bool JobStore::has(const String& sn, JsonDocument& scratch)
+{
+    int idx[4];
+    int n = candidates(sn, idx, 4);
+    for (int k = 0; k < n; ++k) {
+        if (loadJob(idx[k], sn, scratch)) return true;
+    }
+    return false;
+}
+
+int JobStore::findByOffset(uint32_t hash, uint32_t offset) const
+{
+    uint32_t i = hash % capacity;
+    while (entries[i].state != ENTRY_EMPTY) {
+        if (entries[i].hash == hash && entries[i].offset == offset) return (int)i;
+        i = (i + 1) % capacity;
+    }
+    return -1;
+}
+
+void JobStore::appendTombstones(const char* lines, size_t len)
+{
+    // Ένα μικρό append αντί για rewrite όλου του αρχείου
+    bool isNew = !sd.exists(logPath.c_str());
+    FsFile f = sd.open(logPath.c_str(), O_WRONLY | O_CREAT | O_APPEND);
+    if (!f) {
+        Serial.printf("[JOBSTORE] ERROR: cannot append to %s\n", logPath.c_str());
+        return;
+    }
+    if (isNew || f.fileSize() == 0) {
+        f.printf("#%08lx %lu\n", (unsigned long)fileHash, (unsigned long)fileSize);
+    }
+    f.write((const uint8_t*)lines, len);
+    f.close();
+}
+
+// ------------------------------------------
+// Job ids
+// ------------------------------------------
+size_t JobIdHasher::feed(const uint8_t* p, size_t n)
+{
+    if (closed) return 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t c = p[i];
+        if (inStr) {
+            add(c);
+            if (esc) esc = false;
+            else if (c == '\\') esc = true;
+            else if (c == '"') inStr = false;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') continue;
+        add(c);
+        if (c == '"') {
+            inStr = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth <= 0) {
+            closed = true;
+            return i + 1;
+        }
+    }
+    return n;
+}
+
+uint32_t JobStore::recordIdAt(FsFile& f, char kind, uint32_t offset, uint32_t maxLen)
+{
+    JobIdHasher hasher(kind);
+    if (!f.seekSet(offset)) return 0;
+    uint8_t buf[256];
+    uint32_t left = maxLen;
+    while (left > 0 && !hasher.complete()) {
+        int rd = f.read(buf, min((uint32_t)sizeof(buf), left));
+        if (rd <= 0) return 0;
+        hasher.feed(buf, (size_t)rd);
+        left -= (uint32_t)rd;
+    }
+    return hasher.complete() ? hasher.id() : 0;
+}
+
+uint32_t JobStore::recordId(int idx, char kind)
+{
+    if (!isLoaded || idx < 0 || idx >= (int)capacity) return 0;
+    FsFile f = sd.open(filePath.c_str(), O_RDONLY);
+    if (!f) return 0;
+    uint32_t id = recordIdAt(f, kind, entries[idx].offset);
+    f.close();
+    return id;
+}
+
+int JobStore::findById(const String& sn, char kind, uint32_t id)
+{
+    int idx[16];
+    int n = candidates(sn, idx, 16);
+    if (n == 0) return -1;
+    FsFile f = sd.open(filePath.c_str(), O_RDONLY);
+    if (!f) return -1;
+    int found = -1;
+    for (int k = 0; k < n && found < 0; ++k) {
+        const Entry& e = entries[idx[k]];
+        if (recordIdAt(f, kind, e.offset) == id) found = idx[k];
+    }
+    f.close();
+    return found;
+}
+
+bool JobStore::containsId(const String& sn, char kind, uint32_t id)
+{
+    return findById(sn, kind, id) >= 0;
+}
+
+bool JobStore::removeById(const String& sn, char kind, uint32_t id)
+{
+    int i = findById(sn, kind, id);
+    if (i < 0) return false;
+    entries[i].state = ENTRY_REMOVED;
+    live--;
+    tombstones++;
+    char line[48];
+    int w = snprintf(line, sizeof(line), "%lu,%s\n", (unsigned long)entries[i].offset, sn.c_str());
+    if (w > 0 && (size_t)w < sizeof(line)) appendTombstones(line, (size_t)w);
+    return true;
+}
+
+static void onHashOnly(const char*, uint32_t, uint32_t, void*) {}
+
+bool JobStore::unchanged()
+{
+    uint32_t h = 0;
+    return scan(filePath.c_str(), onHashOnly, nullptr, &h) && h == fileHash;
+}
+
+bool JobStore::compact()
+{
+    if (!isLoaded || tombstones == 0) return true;
+
+    unsigned long t0 = millis();
+    uint32_t done = tombstones;
+    if (!unchanged()) {
+        // Π.χ. νέο αρχείο από root: το index (και τα tombstones) δεν ισχύουν πια
+        Serial.printf("[JOBSTORE] %s changed since load, not compacting\n", filePath.c_str());
+        clear();
+        return false;
+    }
+    if (live == 0 && !overflowed) {
+        sd.remove(filePath.c_str());
+        sd.remove(logPath.c_str());
+        Serial.printf("[JOBSTORE] All jobs in %s done, file removed\n", filePath.c_str());
+        clear();
+        return true;
+    }
+    if (!rewrite()) {
+        Serial.printf("[JOBSTORE] ERROR: cannot compact %s\n", filePath.c_str());
+        return false;
+    }
+    Serial.printf("[JOBSTORE] Compacted %s: %lu done jobs dropped in %lu ms\n",
+                  filePath.c_str(), (unsigned long)done, millis() - t0);
+    return true;
+}
+
+// ------------------------------------------
+// Rewrite: αντιγραφή των LIVE records σε νέο αρχείο, ένα SD write
+// ------------------------------------------
+struct JobCopyCtx {
+    JobStore* store;
+    FsFile* src;
+    FsFile* dst;
+    bool first;
+    bool ok;
+};
+
+void JobStore::onCopyRecord(const char* sn, uint32_t offset, uint32_t len, void* ctx)
+{
+    JobCopyCtx* cc = (JobCopyCtx*)ctx;
+    if (!cc->ok || sn[0] == '\0') return;
+    int i = cc->store->findByOffset(hashSn(sn), offset);
+    // REMOVED παραλείπεται. Records εκτός index (overflow) μένουν στο αρχείο.
+    if (i >= 0 && cc->store->entries[i].state == ENTRY_REMOVED) return;
+
+    if (!cc->first) cc->dst->write((const uint8_t*)",\n", 2);
+    cc->first = false;
+
+    uint8_t buf[256];
+    if (!cc->src->seekSet(offset)) {
+        cc->ok = false;
+        return;
+    }
+    uint32_t left = len;
+    while (left > 0) {
+        int rd = cc->src->read(buf, min((uint32_t)sizeof(buf), left));
+        if (rd <= 0 || cc->dst->write(buf, rd) != (size_t)rd) {
+            cc->ok = false;
+            return;
+        }
+        left -= (uint32_t)rd;
+    }
+}
+
+bool JobStore::rewrite()
+{
+    String path = filePath;
+    String tmp = path + ".tmp";
+
+    FsFile src = sd.open(path.c_str(), O_RDONLY);
+    if (!src) return false;
+    sd.remove(tmp.c_str());
+    FsFile dst = sd.open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC);
+    if (!dst) {
+        src.close();
+        return false;
+    }
+
+    JobCopyCtx cc = { this, &src, &dst, true, true };
+    dst.print("{\"jobs\":[\n");
+    bool scanned = scan(path.c_str(), onCopyRecord, &cc);
+    dst.print("\n]}\n");
+    dst.close();
+    src.close();
+
+    if (!scanned || !cc.ok) {
+        sd.remove(tmp.c_str());
+        return false;
+    }
+    // Crash εδώ: το load() βρίσκει το .tmp, και το log δεν ταιριάζει πια
+    // με το νέο αρχείο οπότε αγνοείται
+    String log = logPath;
+    sd.remove(path.c_str());
+    if (!sd.rename(tmp.c_str(), path.c_str())) {
+        return false;
+    }
+    sd.remove(log.c_str());
+    // Τα offsets άλλαξαν: νέο index από το καινούριο αρχείο
+    return load(path.c_str());
+}
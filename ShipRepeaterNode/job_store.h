@@ -0,0 +1,108 @@
+#pragma once
+
+#include "config.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Indexed job file (firmware_jobs.json / config_jobs.json).
+// Το αρχείο διαβάζεται streaming μία φορά ανά AP session και κρατάμε μόνο
+// ένα hash index SN -> offset του κάθε job record. Το record φορτώνεται από
+// την SD μόνο όταν χρειαστεί. Το index (8 bytes ανά slot, load factor έως
+// 75%) δεσμεύεται στο load() στο μέγεθος που χρειάζεται το αρχείο, έως
+// JOB_STORE_INDEX_BYTES (λιγότερο αν δεν χωράει στο heap)· τα jobs που δεν
+// χωράνε περιμένουν επόμενο session (log).
+// Υποστηρίζει {"jobs": [...]} και [...] όπως πριν.
+//
+// Τα jobs που τελείωσαν δεν σβήνονται αμέσως: γράφονται ως tombstones
+// ("offset,sn") σε append-only log δίπλα στο αρχείο (<path>.done) και
+// αγνοούνται στο load. Το compact() ξαναγράφει το αρχείο μία φορά (τέλος
+// του AP window ή idle) και σβήνει το log. Το log έχει header με το hash
+// του αρχείου, οπότε αν το αρχείο αντικατασταθεί (sync από root) αγνοείται.
+
+// Μέγιστο μέγεθος ενός job record όταν φορτώνεται
+#define JOB_RECORD_DOC_SIZE 2048
+
+// Ταυτότητα ενός job record: FNV-1a πάνω στο kind ('f'/'c') και στα bytes
+// του record χωρίς τα κενά εκτός strings. Το ίδιο job έχει το ίδιο id στο
+// αρχείο του root, στο journal και στο αρχείο του collector.
+struct JobIdHasher {
+    explicit JobIdHasher(char kind) { add((uint8_t)kind); }
+    // Γυρίζει πόσα bytes πέρασαν: σταματά στο '}' που κλείνει το record
+    size_t feed(const uint8_t* p, size_t n);
+    bool complete() const { return closed; }
+    uint32_t id() const { return h; }
+
+private:
+    void add(uint8_t b) { h ^= b; h *= 16777619UL; }
+    uint32_t h = 2166136261UL;
+    int depth = 0;
+    bool closed = false;
+    bool inStr = false;
+    bool esc = false;
+};
+
+class JobStore {
+public:
+    // Scan + index. false αν το αρχείο λείπει ή δεν είναι έγκυρο JSON.
+    bool load(const char* path);
+    void clear();
+    bool loaded() const { return isLoaded; }
+    uint32_t size() const { return live; }
+
+    // Υποψήφια records του SN με τη σειρά του αρχείου (ίδιο hash, θέλει loadJob για επιβεβαίωση)
+    int candidates(const String& sn, int* out, int maxOut) const;
+
+    // Φορτώνει το record idx. false αν δεν διαβάζεται ή ανήκει σε άλλο SN (hash collision).
+    bool loadJob(int idx, const String& sn, JsonDocument& doc);
+
+    // Υπάρχει τουλάχιστον ένα job για το SN;
+    bool has(const String& sn, JsonDocument& scratch);
+
+    // Job ids (βλ. JobIdHasher) για το incremental sync με τον root
+    uint32_t recordId(int idx, char kind);
+    bool containsId(const String& sn, char kind, uint32_t id);
+    bool removeById(const String& sn, char kind, uint32_t id);
+    // maxLen: όριο ανάγνωσης, το record τελειώνει στο '}' που το κλείνει
+    static uint32_t recordIdAt(FsFile& f, char kind, uint32_t offset, uint32_t maxLen = 0xFFFFFFFFUL);
+
+    // Ξαναγράφει το αρχείο χωρίς τα ολοκληρωμένα jobs και σβήνει το log
+    bool compact();
+    uint32_t pendingTombstones() const { return tombstones; }
+
+    // Callback του streaming scanner: ένα job record (sn = "" αν δεν έχει)
+    typedef void (*RecordFn)(const char* sn, uint32_t offset, uint32_t len, void* ctx);
+    static bool scan(const char* path, RecordFn fn, void* ctx, uint32_t* hashOut = nullptr);
+
+private:
+    enum EntryState : uint8_t { ENTRY_EMPTY, ENTRY_LIVE, ENTRY_REMOVED };
+
+    struct Entry {
+        uint32_t hash;
+        uint32_t offset : 30;   // αρχεία έως 1 GB
+        uint32_t state : 2;     // EntryState
+    };
+
+    static uint32_t hashSn(const char* sn);
+    static void onCountRecord(const char* sn, uint32_t offset, uint32_t len, void* ctx);
+    static void onIndexRecord(const char* sn, uint32_t offset, uint32_t len, void* ctx);
+    static void onCopyRecord(const char* sn, uint32_t offset, uint32_t len, void* ctx);
+    int findByOffset(uint32_t hash, uint32_t offset) const;
+    int findById(const String& sn, char kind, uint32_t id);
+    void appendTombstones(const char* lines, size_t len);
+    void applyLog();
+    bool unchanged();
+    bool rewrite();
+
+    String filePath;
+    String logPath;
+    uint32_t fileHash = 0;
+    uint32_t fileSize = 0;
+    uint32_t tombstones = 0; // REMOVED που δεν έχουν γίνει compact
+    bool isLoaded = false;
+    uint32_t live = 0;
+    uint32_t used = 0;       // LIVE + REMOVED (οι REMOVED κρατούν το probe chain)
+    bool overflowed = false;
+    uint32_t fileJobs = 0;      // records με sn στο αρχείο (πριν το όριο)
+    Entry* entries = nullptr;   // malloc στο load(), free στο clear()
+    uint32_t capacity = 0;
+};
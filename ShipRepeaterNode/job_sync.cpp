@@ -0,0 +1,628 @@
+#include "job_sync.h"
+#include "job_store.h"
+#include "station_job_manager.h"
+#include <vector>
+#include <algorithm>
+
+extern SdFat sd;
+extern bool initSdCard();
+
+static const char* JSYNC_NS = "jobsync";
+static const char* FW_JOBS_PATH  = "/jobs/firmware_jobs.json";
+static const char* CFG_JOBS_PATH = "/jobs/config_jobs.json";
+
+// Sparse index version -> offset στο journal, μία θέση ανά JSYNC_INDEX_STEP versions
+static const uint32_t JSYNC_INDEX_STEP = 64;
+static const int JSYNC_INDEX_SLOTS = 256;
+
+static const char* jobPath(char kind) {
+    return kind == 'f' ? FW_JOBS_PATH : CFG_JOBS_PATH;
+}
+
+// Μία γραμμή από το f: τα πρώτα cap-1 bytes στο head, όλη η γραμμή στο full (αν δοθεί).
+// -1 στο τέλος του αρχείου.
+static int readLine(FsFile& f, char* head, size_t cap, String* full) {
+    size_t len = 0;
+    int total = 0;
+    int c;
+    if (full) *full = "";
+    while ((c = f.read()) >= 0) {
+        if (c == '\n') break;
+        if (c == '\r') continue;
+        if (len < cap - 1) head[len++] = (char)c;
+        if (full) *full += (char)c;
+        total++;
+    }
+    head[len] = '\0';
+    if (c < 0 && total == 0) return -1;
+    return total;
+}
+
+// ------------------------------------------
+// Root: journal + id index
+// ------------------------------------------
+enum SyncIdState : uint8_t { ID_EMPTY, ID_ADDED, ID_DONE, ID_GONE };
+
+struct SyncId {
+    uint32_t id;
+    char kind;
+    SyncIdState state;
+    bool seen;      // βρέθηκε στο τελευταίο scan του job file
+};
+
+static SyncId* g_ids = nullptr;  // malloc μόνο στον root
+static uint32_t g_idCount = 0;
+static uint32_t g_version = 0;
+static uint32_t g_indexOff[JSYNC_INDEX_SLOTS];
+static int g_indexUsed = 0;
+static bool g_idsFull = false;
+
+// Μέγεθος/mtime του job file στο τελευταίο refresh: αν δεν άλλαξε, δεν ξανασκανάρεται
+struct FileSig {
+    bool exists;
+    uint32_t size;
+    uint16_t date;
+    uint16_t time;
+};
+static FileSig g_fileSig[2];
+static bool g_fileSigValid[2] = { false, false };
+
+// Offset του journal ως το οποίο οι D γραμμές έχουν γίνει tombstones στα αρχεία του root
+static uint32_t g_doneOff = 0;
+static volatile bool g_donePending = false;  // γράφεται από το AsyncTCP handler
+static unsigned long g_lastRefresh = 0;
+
+static SyncId* findId(char kind, uint32_t id, bool insert) {
+    uint32_t i = (id ^ (uint8_t)kind) % JOB_SYNC_MAX_IDS;
+    while (g_ids[i].state != ID_EMPTY) {
+        if (g_ids[i].id == id && g_ids[i].kind == kind) return &g_ids[i];
+        i = (i + 1) % JOB_SYNC_MAX_IDS;
+    }
+    if (!insert) return nullptr;
+    // Πάντα ένα EMPTY για να τελειώνει το probing
+    if (g_idCount + 1 >= JOB_SYNC_MAX_IDS) {
+        if (!g_idsFull) Serial.println("[JOBSYNC] WARNING: job id index full, new jobs not journaled");
+        g_idsFull = true;
+        return nullptr;
+    }
+    g_ids[i].id = id;
+    g_ids[i].kind = kind;
+    g_ids[i].state = ID_EMPTY;  // ο caller ορίζει το state
+    g_ids[i].seen = false;
+    g_idCount++;
+    return &g_ids[i];
+}
+
+// Κάθε νέα γραμμή παίρνει το επόμενο version. Το offset της μπαίνει στο sparse index.
+static uint32_t nextVersion(FsFile& j) {
+    g_version++;
+    if ((g_version - 1) % JSYNC_INDEX_STEP == 0 && g_indexUsed < JSYNC_INDEX_SLOTS) {
+        g_indexOff[g_indexUsed++] = (uint32_t)j.fileSize();
+    }
+    return g_version;
+}
+
+bool jsync_rootBegin() {
+    if (g_ids) return true;
+    if (!initSdCard()) return false;
+    g_ids = (SyncId*)calloc(JOB_SYNC_MAX_IDS, sizeof(SyncId));
+    if (!g_ids) {
+        Serial.println("[JOBSYNC] ERROR: no memory for job id index");
+        return false;
+    }
+
+    unsigned long t0 = millis();
+    FsFile j = sd.open(JSYNC_JOURNAL_PATH, O_RDONLY);
+    if (j) {
+        char head[80];
+        uint32_t lineStart = 0;
+        int n;
+        while ((n = readLine(j, head, sizeof(head), nullptr)) >= 0) {
+            char op = 0, kind = 0;
+            unsigned long ver = 0, id = 0;
+            if (sscanf(head, "%c %lu %c %lx", &op, &ver, &kind, &id) == 4 && ver > g_version) {
+                g_version = (uint32_t)ver;
+                if ((g_version - 1) % JSYNC_INDEX_STEP == 0 && g_indexUsed < JSYNC_INDEX_SLOTS) {
+                    g_indexOff[g_indexUsed++] = lineStart;
+                }
+                SyncId* e = findId(kind, (uint32_t)id, true);
+                if (e) e->state = op == 'A' ? ID_ADDED : op == 'D' ? ID_DONE : ID_GONE;
+            }
+            lineStart = (uint32_t)j.curPosition();
+        }
+        g_doneOff = lineStart;
+        j.close();
+    }
+    Serial.printf("[JOBSYNC] Journal at version %lu (%lu jobs) loaded in %lu ms\n",
+                  (unsigned long)g_version, (unsigned long)g_idCount, millis() - t0);
+    return true;
+}
+
+// Ολοκληρώσεις από collector: μόνο D στο journal. Τα tombstones στο αρχείο
+// του root τα βάζει το jsync_rootPoll() από το loop (load/compact εκτός AsyncTCP).
+static void applyCompletions(FsFile& j, const char* body, size_t len) {
+    size_t pos = 0;
+    while (pos < len) {
+        char line[64];
+        size_t n = 0;
+        while (pos < len && body[pos] != '\n') {
+            if (n < sizeof(line) - 1) line[n++] = body[pos];
+            pos++;
+        }
+        pos++;
+        line[n] = '\0';
+
+        char kind = 0;
+        unsigned long id = 0;
+        char sn[32];
+        if (sscanf(line, "%c %lx %31s", &kind, &id, sn) != 3 || (kind != 'f' && kind != 'c')) continue;
+        SyncId* e = findId(kind, (uint32_t)id, true);
+        if (!e || e->state == ID_DONE) continue;  // ήδη γνωστό (retry του collector)
+        e->state = ID_DONE;
+        uint32_t ver = nextVersion(j);
+        j.printf("D %lu %c %08lx %s\n", (unsigned long)ver, kind, id, sn);
+        g_donePending = true;
+    }
+}
+
+// Οι D γραμμές μετά το g_doneOff γίνονται tombstones στα αρχεία του root,
+// ώστε να μην τα σερβίρει πια (legacy collectors)
+static void applyDoneToFiles() {
+    FsFile r = sd.open(JSYNC_JOURNAL_PATH, O_RDONLY);
+    if (!r) return;
+    uint32_t end = (uint32_t)r.fileSize();
+    r.seekSet(g_doneOff);
+    bool touched[2] = { false, false };
+    uint32_t removed = 0;
+    char head[96];
+    while (r.curPosition() < end && readLine(r, head, sizeof(head), nullptr) >= 0) {
+        char op = 0, kind = 0;
+        unsigned long ver = 0, id = 0;
+        char sn[32];
+        if (sscanf(head, "%c %lu %c %lx %31s", &op, &ver, &kind, &id, sn) != 5 || op != 'D') continue;
+        if (kind != 'f' && kind != 'c') continue;
+        JobStore& store = sjm_jobStore(kind);
+        int k = kind == 'f' ? 0 : 1;
+        if (!touched[k]) {
+            store.load(jobPath(kind));
+            touched[k] = true;
+        }
+        if (store.removeById(String(sn), kind, (uint32_t)id)) removed++;
+    }
+    g_doneOff = (uint32_t)r.curPosition();
+    r.close();
+    for (int k = 0; k < 2; ++k) {
+        if (!touched[k]) continue;
+        JobStore& store = sjm_jobStore(k == 0 ? 'f' : 'c');
+        store.compact();
+        store.clear();
+        g_fileSigValid[k] = false;
+    }
+    if (removed) Serial.printf("[JOBSYNC] %lu completed jobs removed from root files\n", (unsigned long)removed);
+}
+
+struct RefreshCtx {
+    FsFile* src;
+    FsFile* journal;
+    char kind;
+    uint32_t added;
+};
+
+static void onRootRecord(const char* sn, uint32_t offset, uint32_t len, void* ctx) {
+    RefreshCtx* rc = (RefreshCtx*)ctx;
+    if (sn[0] == '\0') return;
+    uint32_t id = JobStore::recordIdAt(*rc->src, rc->kind, offset, len);
+    SyncId* e = findId(rc->kind, id, true);
+    if (!e) return;
+    e->seen = true;
+    if (e->state == ID_ADDED || e->state == ID_DONE) return;
+
+    // Νέο (ή ξανά προστέθηκε): A γραμμή με το record σε μία γραμμή
+    e->state = ID_ADDED;
+    uint32_t ver = nextVersion(*rc->journal);
+    rc->journal->printf("A %lu %c %08lx %s ", (unsigned long)ver, rc->kind, (unsigned long)id, sn);
+    uint8_t buf[256];
+    uint32_t left = len;
+    rc->src->seekSet(offset);
+    while (left > 0) {
+        int rd = rc->src->read(buf, min((uint32_t)sizeof(buf), left));
+        if (rd <= 0) break;
+        for (int i = 0; i < rd; ++i) {
+            if (buf[i] == '\r' || buf[i] == '\n' || buf[i] == '\t') buf[i] = ' ';
+        }
+        rc->journal->write(buf, (size_t)rd);
+        left -= (uint32_t)rd;
+    }
+    rc->journal->write((const uint8_t*)"\n", 1);
+    rc->added++;
+}
+
+static void markGone(FsFile& j, char kind, SyncId& e, const char* sn) {
+    e.state = ID_GONE;
+    uint32_t ver = nextVersion(j);
+    j.printf("R %lu %c %08lx %s\n", (unsigned long)ver, kind, (unsigned long)e.id, sn);
+}
+
+// R για τα ids που δεν βρέθηκαν στο scan (ADDED και !seen). Το sn τους είναι
+// στην A γραμμή: ένα πέρασμα του journal για όλα μαζί, ως το σημερινό τέλος του.
+static uint32_t removeUnseen(FsFile& j, char kind) {
+    uint32_t pending = 0;
+    for (uint32_t i = 0; i < JOB_SYNC_MAX_IDS; ++i) {
+        const SyncId& e = g_ids[i];
+        if (e.state == ID_ADDED && e.kind == kind && !e.seen) pending++;
+    }
+    if (pending == 0) return 0;
+
+    uint32_t gone = 0;
+    j.flush();
+    FsFile r = sd.open(JSYNC_JOURNAL_PATH, O_RDONLY);
+    if (r) {
+        uint32_t end = (uint32_t)r.fileSize();
+        char head[96];
+        while (gone < pending && r.curPosition() < end && readLine(r, head, sizeof(head), nullptr) >= 0) {
+            char op = 0, k = 0;
+            unsigned long ver = 0, id = 0;
+            char sn[32];
+            if (sscanf(head, "%c %lu %c %lx %31s", &op, &ver, &k, &id, sn) != 5 || op != 'A' || k != kind) continue;
+            SyncId* e = findId(kind, (uint32_t)id, false);
+            if (!e || e->state != ID_ADDED || e->seen) continue;
+            markGone(j, kind, *e, sn);
+            gone++;
+        }
+        r.close();
+    }
+    // Χωρίς A γραμμή (δεν θα έπρεπε): R χωρίς sn
+    for (uint32_t i = 0; i < JOB_SYNC_MAX_IDS && gone < pending; ++i) {
+        SyncId& e = g_ids[i];
+        if (e.state != ID_ADDED || e.kind != kind || e.seen) continue;
+        markGone(j, kind, e, "-");
+        gone++;
+    }
+    return gone;
+}
+
+static FileSig fileSig(const char* path) {
+    FileSig sig = { false, 0, 0, 0 };
+    FsFile f = sd.open(path, O_RDONLY);
+    if (f) {
+        sig.exists = true;
+        sig.size = (uint32_t)f.fileSize();
+        f.getModifyDateTime(&sig.date, &sig.time);
+        f.close();
+    }
+    return sig;
+}
+
+// Νέα jobs (A) και jobs που σβήστηκαν από τον operator (R)
+static void refreshKind(FsFile& j, char kind) {
+    const char* path = jobPath(kind);
+    int k = kind == 'f' ? 0 : 1;
+    FileSig sig = fileSig(path);
+    const FileSig& last = g_fileSig[k];
+    if (g_fileSigValid[k] && sig.exists == last.exists && sig.size == last.size &&
+        sig.date == last.date && sig.time == last.time) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < JOB_SYNC_MAX_IDS; ++i) {
+        if (g_ids[i].kind == kind) g_ids[i].seen = false;
+    }
+    RefreshCtx rc = { nullptr, &j, kind, 0 };
+    if (sig.exists) {
+        FsFile src = sd.open(path, O_RDONLY);
+        if (!src) return;
+        rc.src = &src;
+        bool ok = JobStore::scan(path, onRootRecord, &rc);
+        src.close();
+        // Άκυρο JSON (π.χ. μισοαντιγραμμένο): όχι R για όλα τα jobs
+        if (!ok) return;
+    }
+
+    uint32_t gone = removeUnseen(j, kind);
+    g_fileSig[k] = sig;
+    g_fileSigValid[k] = true;
+    if (rc.added || gone) {
+        Serial.printf("[JOBSYNC] %s: %lu new, %lu removed, version %lu\n", path,
+                      (unsigned long)rc.added, (unsigned long)gone, (unsigned long)g_version);
+    }
+}
+
+static void buildResponse(uint32_t since, String& out) {
+    out = "";
+    // Journal από άλλη SD / σβήστηκε: ο collector ξεκινά από την αρχή
+    if (since > g_version) since = 0;
+    uint32_t last = since;
+    bool more = false;
+
+    if (since < g_version) {
+        FsFile j = sd.open(JSYNC_JOURNAL_PATH, O_RDONLY);
+        if (j) {
+            int slot = (int)(since / JSYNC_INDEX_STEP);
+            if (slot >= g_indexUsed) slot = g_indexUsed - 1;
+            if (slot > 0) j.seekSet(g_indexOff[slot]);
+
+            char head[32];
+            String line;
+            while (readLine(j, head, sizeof(head), &line) >= 0) {
+                char op = 0;
+                unsigned long ver = 0;
+                if (sscanf(head, "%c %lu", &op, &ver) != 2 || ver <= since) continue;
+                if (out.length() > 0 && out.length() + line.length() + 1 > JOB_SYNC_MAX_RESPONSE) {
+                    more = true;
+                    break;
+                }
+                out += line;
+                out += '\n';
+                last = (uint32_t)ver;
+            }
+            j.close();
+        }
+    }
+    if (!more) last = g_version;
+    out += "V " + String((unsigned long)last) + " " + (more ? "1" : "0") + "\n";
+}
+
+bool jsync_rootExchange(uint32_t since, const char* completions, size_t len, String& out) {
+    if (!jsync_rootBegin()) return false;
+
+    unsigned long t0 = millis();
+    if (len > 0) {
+        FsFile j = sd.open(JSYNC_JOURNAL_PATH, O_WRONLY | O_CREAT | O_APPEND);
+        if (!j) {
+            Serial.println("[JOBSYNC] ERROR: cannot open journal");
+            return false;
+        }
+        applyCompletions(j, completions, len);
+        j.close();
+    }
+
+    buildResponse(since, out);
+    Serial.printf("[JOBSYNC] Sync since %lu: %u bytes in %lu ms\n",
+                  (unsigned long)since, (unsigned)out.length(), millis() - t0);
+    return true;
+}
+
+void jsync_rootPoll() {
+    if (!g_ids) return;
+    bool due = millis() - g_lastRefresh >= JOB_SYNC_REFRESH_MS;
+    if (!due && !g_donePending) return;
+
+    SdBusGuard sdBus;
+    if (!initSdCard()) return;
+    if (g_donePending) {
+        g_donePending = false;
+        applyDoneToFiles();
+    }
+    if (!due) return;
+    g_lastRefresh = millis();
+    FsFile j = sd.open(JSYNC_JOURNAL_PATH, O_WRONLY | O_CREAT | O_APPEND);
+    if (!j) {
+        Serial.println("[JOBSYNC] ERROR: cannot open journal");
+        return;
+    }
+    refreshKind(j, 'f');
+    refreshKind(j, 'c');
+    j.close();
+}
+
+// ------------------------------------------
+// Collector
+// ------------------------------------------
+void jsync_recordCompletion(char kind, const String& sn, const uint32_t* ids, int n) {
+    if (n <= 0 || !initSdCard()) return;
+    FsFile f = sd.open(JSYNC_OUTBOX_PATH, O_WRONLY | O_CREAT | O_APPEND);
+    if (!f) {
+        Serial.println("[JOBSYNC] ERROR: cannot append to outbox");
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        f.printf("%c %08lx %s\n", kind, (unsigned long)ids[i], sn.c_str());
+    }
+    f.close();
+}
+
+uint32_t jsync_version() {
+    uint32_t v = 0;
+    if (preferences.begin(JSYNC_NS, true)) {
+        v = preferences.getUInt("ver", 0);
+        preferences.end();
+    }
+    return v;
+}
+
+bool jsync_outbox(String& body) {
+    body = "";
+    if (!initSdCard() || !sd.exists(JSYNC_OUTBOX_PATH)) return false;
+    FsFile f = sd.open(JSYNC_OUTBOX_PATH, O_RDONLY);
+    if (!f) return false;
+    uint32_t size = (uint32_t)f.fileSize();
+    uint32_t want = min(size, (uint32_t)JOB_SYNC_MAX_RESPONSE);
+    body.reserve(want);
+    uint8_t buf[256];
+    uint32_t left = want;
+    int rd;
+    while (left > 0 && (rd = f.read(buf, min((uint32_t)sizeof(buf), left))) > 0) {
+        for (int i = 0; i < rd; ++i) body += (char)buf[i];
+        left -= (uint32_t)rd;
+    }
+    f.close();
+    // Μόνο ολόκληρες γραμμές
+    int cut = body.lastIndexOf('\n');
+    body.remove(cut + 1);
+    return body.length() > 0;
+}
+
+void jsync_commit(uint32_t version, size_t sentBytes) {
+    preferences.begin(JSYNC_NS, false);
+    preferences.putUInt("ver", version);
+    preferences.end();
+    if (sentBytes == 0) return;
+
+    FsFile f = sd.open(JSYNC_OUTBOX_PATH, O_RDONLY);
+    if (!f) return;
+    if (f.fileSize() <= sentBytes) {
+        f.close();
+        sd.remove(JSYNC_OUTBOX_PATH);
+        return;
+    }
+    // Σπάνιο (πολλές ολοκληρώσεις): το υπόλοιπο σε νέο outbox
+    String tmp = String(JSYNC_OUTBOX_PATH) + ".tmp";
+    FsFile dst = sd.open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC);
+    if (!dst) {
+        f.close();
+        return;
+    }
+    f.seekSet(sentBytes);
+    uint8_t buf[256];
+    int rd;
+    while ((rd = f.read(buf, sizeof(buf))) > 0) dst.write(buf, (size_t)rd);
+    dst.close();
+    f.close();
+    sd.remove(JSYNC_OUTBOX_PATH);
+    sd.rename(tmp.c_str(), JSYNC_OUTBOX_PATH);
+}
+
+// Προσθέτει ένα record στο τέλος του jobs array χωρίς να ξαναγράψει το αρχείο
+static bool appendRecord(const char* path, const char* json) {
+    if (!sd.exists(path)) {
+        FsFile f = sd.open(path, O_WRONLY | O_CREAT | O_TRUNC);
+        if (!f) return false;
+        f.print("{\"jobs\":[\n");
+        f.print(json);
+        f.print("\n]}\n");
+        f.close();
+        return true;
+    }
+
+    FsFile f = sd.open(path, O_RDWR);
+    if (!f) return false;
+    uint32_t size = (uint32_t)f.fileSize();
+    char tail[64];
+    uint32_t tailStart = size > sizeof(tail) ? size - sizeof(tail) : 0;
+    f.seekSet(tailStart);
+    int n = f.read((uint8_t*)tail, size - tailStart);
+
+    // Το ']' που κλείνει το array και ό,τι ακολουθεί ('}' για {"jobs": [...]})
+    int close = -1;
+    for (int i = n - 1; i >= 0; --i) {
+        if (tail[i] == ']') { close = i; break; }
+    }
+    if (close < 0) {
+        f.close();
+        Serial.printf("[JOBSYNC] ERROR: cannot append to %s (no closing ])\n", path);
+        return false;
+    }
+    bool wrapped = false;
+    for (int i = close + 1; i < n; ++i) {
+        if (tail[i] == '}') wrapped = true;
+    }
+    char prev = 0;
+    for (int i = close - 1; i >= 0 && !prev; --i) {
+        if (tail[i] != ' ' && tail[i] != '\t' && tail[i] != '\r' && tail[i] != '\n') prev = tail[i];
+    }
+
+    f.seekSet(tailStart + (uint32_t)close);
+    f.print(prev == '[' ? "\n" : ",\n");
+    f.print(json);
+    f.print(wrapped ? "\n]}\n" : "\n]\n");
+    f.truncate(f.curPosition());
+    f.close();
+    return true;
+}
+
+struct SyncLine {
+    char op;
+    char kind;
+    uint32_t ver;
+    uint32_t id;
+    char sn[32];
+    const char* json;  // A: το record (μέσα στο line)
+};
+
+static bool parseLine(const String& line, SyncLine& out) {
+    unsigned long ver = 0, id = 0;
+    int consumed = 0;
+    out.json = nullptr;
+    if (line.startsWith("V ")) {
+        unsigned long more = 0;
+        if (sscanf(line.c_str(), "V %lu %lu", &ver, &more) != 2) return false;
+        out.op = 'V';
+        out.ver = (uint32_t)ver;
+        out.id = (uint32_t)more;
+        return true;
+    }
+    if (sscanf(line.c_str(), "%c %lu %c %lx %31s %n", &out.op, &ver, &out.kind, &id, out.sn, &consumed) < 5) {
+        return false;
+    }
+    if (out.kind != 'f' && out.kind != 'c') return false;
+    out.ver = (uint32_t)ver;
+    out.id = (uint32_t)id;
+    if (out.op == 'A') {
+        if (consumed <= 0 || consumed >= (int)line.length()) return false;
+        out.json = line.c_str() + consumed;
+    }
+    return true;
+}
+
+// Δύο περάσματα: πρώτα D/R (tombstones + compaction), μετά τα A στο τέλος
+// των αρχείων, ώστε τα offsets του index να μην αλλάζουν ενδιάμεσα
+bool jsync_applyResponse(const char* path, uint32_t& versionOut, bool& moreOut) {
+    if (!initSdCard()) return false;
+    FsFile f = sd.open(path, O_RDONLY);
+    if (!f) return false;
+
+    JobStore& fw = sjm_jobStore('f');
+    JobStore& cfg = sjm_jobStore('c');
+    fw.load(FW_JOBS_PATH);
+    cfg.load(CFG_JOBS_PATH);
+
+    // ids που τελείωσαν/σβήστηκαν: ένα παλιότερο A τους δεν ξαναμπαίνει
+    std::vector<std::pair<uint32_t, uint32_t>> gone;  // (id^kind, version)
+    bool haveVersion = false;
+    uint32_t removed = 0, added = 0;
+    char head[8];
+    String line;
+    SyncLine sl;
+    while (readLine(f, head, sizeof(head), &line) >= 0) {
+        if (!parseLine(line, sl)) continue;
+        if (sl.op == 'V') {
+            versionOut = sl.ver;
+            moreOut = sl.id != 0;
+            haveVersion = true;
+        } else if (sl.op == 'D' || sl.op == 'R') {
+            gone.push_back(std::make_pair(sl.id ^ (uint8_t)sl.kind, sl.ver));
+            JobStore& store = sl.kind == 'f' ? fw : cfg;
+            if (store.removeById(String(sl.sn), sl.kind, sl.id)) removed++;
+        }
+    }
+    if (!haveVersion) {
+        f.close();
+        sjm_resetJobCache();
+        Serial.println("[JOBSYNC] Incomplete response, ignored");
+        return false;
+    }
+    fw.compact();
+    cfg.compact();
+
+    f.seekSet(0);
+    while (readLine(f, head, sizeof(head), &line) >= 0) {
+        if (head[0] != 'A' || !parseLine(line, sl)) continue;
+        uint32_t key = sl.id ^ (uint8_t)sl.kind;
+        bool superseded = std::any_of(gone.begin(), gone.end(), [&](const std::pair<uint32_t, uint32_t>& g) {
+            return g.first == key && g.second > sl.ver;
+        });
+        if (superseded) continue;
+        JobStore& store = sl.kind == 'f' ? fw : cfg;
+        // Ήδη εδώ (π.χ. από παλιό full download ή retry)
+        if (store.containsId(String(sl.sn), sl.kind, sl.id)) continue;
+        if (appendRecord(jobPath(sl.kind), sl.json)) added++;
+    }
+    f.close();
+    sd.remove(path);
+
+    // Τα αρχεία άλλαξαν: νέο index στο επόμενο AP session
+    sjm_resetJobCache();
+    Serial.printf("[JOBSYNC] Applied up to version %lu: %lu new, %lu done/removed\n",
+                  (unsigned long)versionOut, (unsigned long)added, (unsigned long)removed);
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "config.h"
+#include <Arduino.h>
+
+// Incremental, versioned sync των job files root -> collectors.
+//
+// Ο root κρατάει append-only journal (/jobs/journal.log) με μία γραμμή ανά
+// αλλαγή και αύξοντα version:
+//   A <ver> <f|c> <id> <sn> <record json σε μία γραμμή>   νέο job
+//   D <ver> <f|c> <id> <sn>                               έγινε σε κάποιον collector
+//   R <ver> <f|c> <id> <sn>                               σβήστηκε από το αρχείο του root
+// Το id είναι το JobIdHasher του record (f = firmware, c = config).
+//
+// Ο collector κάνει POST /jobs/since/<ver> με body τις ολοκληρώσεις του
+// (outbox, γραμμές "<f|c> <id> <sn>") και παίρνει μόνο τις αλλαγές μετά το
+// <ver>, με τελευταία γραμμή "V <ver> <more>". Το version του collector
+// μένει στο NVS, οπότε ένα sync στέλνει λίγα bytes αντί για όλα τα αρχεία.
+
+#define JSYNC_JOURNAL_PATH  "/jobs/journal.log"
+#define JSYNC_OUTBOX_PATH   "/jobs/outbox.log"
+#define JSYNC_RESPONSE_PATH "/jobs/sync.tmp"
+
+// ---------- Root ----------
+bool jsync_rootBegin();  // φορτώνει το journal (μία φορά)
+// Από το AsyncTCP handler, με το SD bus lock: γράφει D για τις ολοκληρώσεις
+// και στο out τις αλλαγές μετά το since (το πολύ JOB_SYNC_MAX_RESPONSE bytes)
+bool jsync_rootExchange(uint32_t since, const char* completions, size_t len, String& out);
+// Από το loop: αλλαγές στα job files (A/R, κάθε JOB_SYNC_REFRESH_MS) και
+// tombstones/compaction στα αρχεία του root για ό,τι ολοκληρώθηκε
+void jsync_rootPoll();
+
+// ---------- Collector ----------
+void jsync_recordCompletion(char kind, const String& sn, const uint32_t* ids, int n);
+uint32_t jsync_version();
+// Το επόμενο κομμάτι του outbox (ολόκληρες γραμμές, το πολύ JOB_SYNC_MAX_RESPONSE bytes)
+bool jsync_outbox(String& body);
+// Εφαρμόζει ένα response που σώθηκε στο path. false αν δεν είναι έγκυρο (χωρίς "V").
+bool jsync_applyResponse(const char* path, uint32_t& versionOut, bool& moreOut);
+// Σώζει το νέο version και βγάζει από το outbox τα sentBytes που έφτασαν στον root
+void jsync_commit(uint32_t version, size_t sentBytes);
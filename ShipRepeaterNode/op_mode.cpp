@@ -2,6 +2,11 @@
 #include "firmware_updater.h"
 #include "config_updater.h"
 #include "station_job_manager.h"
+#include "sensor_http.h"
+#include "job_sync.h"
+#include "spsc_ring.h"
+#include "heartbeat_logger.h"
+#include "body_arena.h"
 #include <ArduinoJson.h>
 #include <vector>
 #include <map>
@@ -78,57 +83,50 @@ bool apActive = false;
 bool needToSyncTime = false;
 // Κάπου δίπλα στα άλλα singletons
 static SensorHeartbeatManager heartbeatManager;
+static BodyArena sensorBodyArena;  // reassembly των JSON bodies του sensor AP
 // Heartbeat server for sensors on port 3000
 static AsyncWebServer sensorServer(3000);
 
 // BLE Mesh Wake-up: Beacon for Root/Repeater, Scanner for Collector/Repeater
 static BLEBeaconManager bleBeacon;
+static BLEAdvScheduler bleAdvScheduler;
 static BLEScannerManager bleScanner;
 
-// === Simple Memory-Based Buffer for Callback-to-Loop Communication ===
+// === Lock-free Buffer for Callback-to-Loop Communication ===
 // FreeRTOS queues cause mutex crashes when used from AsyncWebServer callbacks.
-// This uses simple volatile arrays that are safe to write from any context.
+// Single producer (AsyncTCP task) / single consumer (main loop) ring, βλ. spsc_ring.h
 
 // Heartbeat buffer - stores pending heartbeats for SD logging and job execution
 struct HeartbeatEntry {
   char sensorSn[32];
-  char sensorIp[20];
-  bool hasData;
+  uint32_t sensorIp;  // (uint32_t)IPAddress
   bool needsJobCheck;
-  uint8_t statusData[256];
-  size_t statusDataLen;
+  bool hasStatus;
+  StatusLogFields status;  // parsed στον /api/status handler, όχι το body
 };
 
-static volatile int hbBufferWriteIdx = 0;
-static volatile int hbBufferReadIdx = 0;
-static const int HB_BUFFER_SIZE = 10;
-static HeartbeatEntry hbBuffer[HB_BUFFER_SIZE];
+static const uint32_t HB_BUFFER_SIZE = 16;
+static SpscRing<HeartbeatEntry, HB_BUFFER_SIZE> hbBuffer;
+static HeartbeatLogger hbLog;  // /received/status.bin ανοιχτό για όλο το AP window
 
 // Queue a heartbeat from callback (safe - no FreeRTOS calls)
-static void bufferHeartbeat(const String& sn, const String& ip, bool needsJobCheck = false, 
-                            const uint8_t* statusData = nullptr, size_t statusDataLen = 0) {
-  int nextIdx = (hbBufferWriteIdx + 1) % HB_BUFFER_SIZE;
-  if (nextIdx == hbBufferReadIdx) {
-    // Buffer full, drop oldest
-    hbBufferReadIdx = (hbBufferReadIdx + 1) % HB_BUFFER_SIZE;
-  }
-  
-  HeartbeatEntry& entry = hbBuffer[hbBufferWriteIdx];
-  strncpy((char*)entry.sensorSn, sn.c_str(), sizeof(entry.sensorSn) - 1);
-  entry.sensorSn[sizeof(entry.sensorSn) - 1] = '\0';
-  strncpy((char*)entry.sensorIp, ip.c_str(), sizeof(entry.sensorIp) - 1);
-  entry.sensorIp[sizeof(entry.sensorIp) - 1] = '\0';
-  entry.hasData = true;
-  entry.needsJobCheck = needsJobCheck;
-  
-  if (statusData && statusDataLen > 0 && statusDataLen <= sizeof(entry.statusData)) {
-    memcpy((void*)entry.statusData, statusData, statusDataLen);
-    entry.statusDataLen = statusDataLen;
-  } else {
-    entry.statusDataLen = 0;
+// Χωρίς heap: SN ως char*, IP binary
+static void bufferHeartbeat(const char* sn, uint32_t ip, bool needsJobCheck = false, 
+                            const StatusLogFields* status = nullptr) {
+  HeartbeatEntry* entry = hbBuffer.beginPush();
+  if (!entry) {
+    // Buffer full: το main loop αργεί, το νέο heartbeat χάνεται (μετράει στα overflows)
+    return;
   }
+
+  strncpy(entry->sensorSn, sn, sizeof(entry->sensorSn) - 1);
+  entry->sensorSn[sizeof(entry->sensorSn) - 1] = '\0';
+  entry->sensorIp = ip;
+  entry->needsJobCheck = needsJobCheck;
+  entry->hasStatus = status != nullptr;
+  if (status) entry->status = *status;
   
-  hbBufferWriteIdx = nextIdx;
+  hbBuffer.commitPush();
 }
 
 // Forward declaration - implemented after ensureDir
@@ -145,6 +143,21 @@ RTC_DATA_ATTR time_t rtc_last_known_time = 0;
 RTC_DATA_ATTR uint32_t rtc_last_sleep_duration_s = 0;
 RTC_DATA_ATTR State rtc_next_state = STATE_INITIAL;
 
+// Parent που βρέθηκε με BLE, ώστε τα επόμενα uplink windows να συνδέονται
+// κατευθείαν χωρίς BLE init + scan (βλ. parentFromCache / parentFromScan)
+struct ParentCache {
+  bool valid;
+  char ssid[33];
+  uint8_t bleAddr[6];
+  int8_t rssi;
+  uint8_t role;
+  time_t lastSuccess;       // τελευταίο επιτυχημένο connect στο SSID
+  uint16_t cyclesSinceScan;
+};
+RTC_DATA_ATTR static ParentCache rtc_parent = {};
+RTC_DATA_ATTR static uint32_t rtc_parent_hits = 0;
+RTC_DATA_ATTR static uint32_t rtc_parent_misses = 0;
+
 // TX state (collector) for HTTP uploads from SD queue
 static bool txActive = false;
 
@@ -153,7 +166,6 @@ static bool txActive = false;
 // =============================
 static const char* QUEUE_DIR = "/queue";
 static const char* RECEIVED_DIR = "/received";
-static const char* JOB_FILE = "/jobs/job.json";
 static const char* QUEUE_NS = "queue_store";
 
 static void ensureDir(const char* path) {
@@ -173,105 +185,39 @@ static void ensureDir(const char* path) {
 
 // Process buffered heartbeats from main loop (safe for SD and job operations)
 static void processHeartbeatBuffer() {
-  while (hbBufferReadIdx != hbBufferWriteIdx) {
-    HeartbeatEntry& entry = hbBuffer[hbBufferReadIdx];
+  HeartbeatEntry* next;
+  while ((next = hbBuffer.front()) != nullptr) {
+    HeartbeatEntry& entry = *next;
+    String sn = String((char*)entry.sensorSn);
+    String ip = IPAddress(entry.sensorIp).toString();
     
-    if (entry.hasData) {
-      String sn = String((char*)entry.sensorSn);
-      String ip = String((char*)entry.sensorIp);
-      
-      // Update last heartbeat time
-      lastHeartbeatMillis = millis();
-      
-      // Log heartbeat to SD
-      if (initSdCard()) {
-        ensureDir(RECEIVED_DIR);
-        
-        // Get timestamp
-        time_t now;
-        time(&now);
-        struct tm* timeinfo = localtime(&now);
-        char timestamp[32];
-        if (timeinfo && timeinfo->tm_year > (2023 - 1900)) {
-          snprintf(timestamp, sizeof(timestamp), "%04d-%02d-%02dT%02d:%02d:%02d.000Z",
-                   timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
-                   timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
-        } else {
-          snprintf(timestamp, sizeof(timestamp), "T%lu", millis());
-        }
-        
-        // Append heartbeat to CSV
-        FsFile f = sd.open("/received/heartbeat_api.csv", O_WRONLY | O_CREAT | O_APPEND);
-        if (f) {
-          f.printf("%s,%s,%s\n", timestamp, sn.c_str(), ip.c_str());
-          f.close();
-          Serial.printf("[HB-BUFFER] Logged heartbeat to SD: %s\n", sn.c_str());
-        }
-        
-        // Save status data if present
-        if (entry.statusDataLen > 0) {
-          char statusFile[64];
-          snprintf(statusFile, sizeof(statusFile), "/received/status_%s_%lu.txt", 
-                   sn.c_str(), (unsigned long)now);
-          FsFile sf = sd.open(statusFile, O_WRONLY | O_CREAT | O_TRUNC);
-          if (sf) {
-            sf.write((uint8_t*)entry.statusData, entry.statusDataLen);
-            sf.close();
-            Serial.printf("[HB-BUFFER] Saved status data: %s (%d bytes)\n", 
-                         statusFile, (int)entry.statusDataLen);
-          }
-        }
-      }
-      
-      // Execute jobs if needed
-      if (entry.needsJobCheck) {
-        Serial.printf("[HB-BUFFER] Checking jobs for SN=%s IP=%s\n", sn.c_str(), ip.c_str());
-        bool didJobs = processJobsForSN(sn, ip);
-        if (didJobs) {
-          Serial.printf("[HB-BUFFER] Jobs executed for SN=%s\n", sn.c_str());
-        } else {
-          Serial.printf("[HB-BUFFER] No jobs found for SN=%s\n", sn.c_str());
-        }
+    // Update last heartbeat time
+    lastHeartbeatMillis = millis();
+    
+    // Log heartbeat (record στη RAM· στην SD από το hbLog.poll() ή όταν γεμίσει
+    // το pending, με το SD bus lock μέσα στο flush())
+    hbLog.log(entry.sensorSn, entry.sensorIp, entry.hasStatus ? &entry.status : nullptr);
+    
+    // Execute jobs if needed
+    if (entry.needsJobCheck) {
+      Serial.printf("[HB-BUFFER] Checking jobs for SN=%s IP=%s\n", sn.c_str(), ip.c_str());
+      bool didJobs = processJobsForSN(sn, ip);
+      if (didJobs) {
+        Serial.printf("[HB-BUFFER] Jobs scheduled for SN=%s\n", sn.c_str());
+      } else {
+        Serial.printf("[HB-BUFFER] No jobs found for SN=%s\n", sn.c_str());
       }
-      
-      entry.hasData = false;
     }
-    
-    hbBufferReadIdx = (hbBufferReadIdx + 1) % HB_BUFFER_SIZE;
-  }
-}
 
-// Log heartbeat to CSV file (like sensordaemon)
-static void appendToHeartbeatLog(const String& sensorSn) {
-  if (!initSdCard()) return;
-  
-  ensureDir(RECEIVED_DIR);
-  const char* hbFile = "/received/heartbeat_api.csv";
-  
-  // Get current time (epoch or millis if no RTC sync)
-  time_t now;
-  time(&now);
-  struct tm* timeinfo = localtime(&now);
-  
-  char timestamp[32];
-  if (timeinfo && timeinfo->tm_year > (2023 - 1900)) {
-    // Valid time - use ISO 8601 format
-    snprintf(timestamp, sizeof(timestamp), "%04d-%02d-%02dT%02d:%02d:%02d.000Z",
-             timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
-             timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
-  } else {
-    // No valid time - use millis
-    snprintf(timestamp, sizeof(timestamp), "T%lu", millis());
+    hbBuffer.pop();
   }
-  
-  // Append to CSV file
-  FsFile f = sd.open(hbFile, O_WRONLY | O_CREAT | O_APPEND);
-  if (f) {
-    f.printf("%s,%s\n", timestamp, sensorSn.c_str());
-    f.close();
-    Serial.printf("[HB] Logged heartbeat: %s,%s\n", timestamp, sensorSn.c_str());
-  } else {
-    Serial.printf("[HB] Failed to open %s\n", hbFile);
+
+  static uint32_t reportedOverflows = 0;
+  if (hbBuffer.overflows() != reportedOverflows) {
+    reportedOverflows = hbBuffer.overflows();
+    Serial.printf("[HB-BUFFER] WARNING: %lu heartbeats dropped (buffer full, high watermark %lu/%lu)\n",
+                  (unsigned long)reportedOverflows, (unsigned long)hbBuffer.highWatermark(),
+                  (unsigned long)hbBuffer.capacity());
   }
 }
 
@@ -423,6 +369,46 @@ void ensureRootHttpServer() {
     }
   });
 
+  // Incremental job sync: POST /jobs/since/<version>, body = ολοκληρώσεις του collector
+  jsync_rootBegin();
+  rootServer.on(
+    "/jobs/since/*", HTTP_ANY,
+    [](AsyncWebServerRequest* req) {
+      // Το body μαζεύεται από τον body handler σε malloc buffer (το free το κάνει ο server)
+      if (req->contentLength() > JOB_SYNC_MAX_RESPONSE) {
+        req->send(413, "text/plain", "Too many completions");
+        return;
+      }
+      // Το malloc απέτυχε: όχι 200 με άδειο body, αλλιώς ο collector σβήνει το outbox
+      if (req->contentLength() > 0 && !req->_tempObject) {
+        req->send(503, "text/plain", "No memory for completions");
+        return;
+      }
+      const char* completions = (const char*)req->_tempObject;
+      size_t len = completions ? req->contentLength() : 0;
+      uint32_t since = (uint32_t)strtoul(req->url().c_str() + strlen("/jobs/since/"), nullptr, 10);
+      // AsyncTCP task: μόνο journal (scan/compaction στο jsync_rootPoll() του loop),
+      // με όριο αναμονής για το SD bus
+      if (!sdBusLock(JOB_SYNC_LOCK_MS)) {
+        req->send(503, "text/plain", "SD busy");
+        return;
+      }
+      String body;
+      bool ok = initSdCard() && jsync_rootExchange(since, completions, len, body);
+      sdBusUnlock();
+      if (!ok) {
+        req->send(500, "text/plain", "Job sync failed");
+        return;
+      }
+      req->send(200, "text/plain", body);
+    },
+    nullptr,
+    [](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t index, size_t total) {
+      if (total > JOB_SYNC_MAX_RESPONSE) return;  // ο collector στέλνει το outbox σε κομμάτια
+      if (index == 0 && !req->_tempObject) req->_tempObject = malloc(total);
+      if (req->_tempObject) memcpy((uint8_t*)req->_tempObject + index, data, len);
+    });
+
   // Serve firmware hex files
   // Note: For large files, consider using chunked response to avoid memory issues
   rootServer.on("/firmware/*", HTTP_GET, [](AsyncWebServerRequest* req) {
@@ -500,6 +486,22 @@ void ensureWiFiAPRepeater() {
 static bool repeaterHttpActive = false;
 static AsyncWebServer rptServer(8080);
 
+// Πόσο ακριβής είναι η ώρα μας (± s), για το MeshTimeInfo του beacon:
+// accuracy της πηγής + drift από τότε. MESH_TIME_UNKNOWN χωρίς sync.
+static uint32_t timeSyncMillis = 0;
+static uint8_t timeSyncAccuracy = MESH_TIME_UNKNOWN;
+
+static void noteTimeSync(uint8_t accuracy) {
+  timeSyncMillis = millis();
+  timeSyncAccuracy = accuracy;
+}
+
+static uint8_t currentTimeAccuracy() {
+  if (timeSyncAccuracy == MESH_TIME_UNKNOWN) return MESH_TIME_UNKNOWN;
+  uint32_t drift = (uint32_t)((uint64_t)(millis() - timeSyncMillis) * MESH_TIME_DRIFT_PPM / 1000000000ULL);
+  return (uint8_t)min<uint32_t>(timeSyncAccuracy + drift, MESH_TIME_UNKNOWN - 1);
+}
+
 bool syncTimeFromUplink(unsigned long timeout_ms) {
   if (WiFi.getMode() == WIFI_OFF) WiFi.mode(WIFI_STA);
   if (WiFi.status() != WL_CONNECTED) {
@@ -548,6 +550,7 @@ bool syncTimeFromUplink(unsigned long timeout_ms) {
     settimeofday(&tv, NULL);
     persistRtcTime((time_t)epoch);
     needToSyncTime = false;
+    noteTimeSync(MESH_TIME_HTTP_ACCURACY_S);
     Serial.printf("[TIME] Synced from uplink: %lu\n", epoch);
     return true;
   }
@@ -651,7 +654,7 @@ bool downloadFileFromRoot(const String& remotePath, const String& localPath) {
     Serial.printf("[DOWNLOAD] Connecting STA to %s...\n", config.uplinkSSID.c_str());
     WiFi.begin(config.uplinkSSID.c_str(), config.uplinkPASS.c_str());
     unsigned long t0 = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - t0 < 10000) { delay(200); }
+    while (WiFi.status() != WL_CONNECTED && millis() - t0 < 10000) { esp_task_wdt_reset(); delay(200); }
   }
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("[DOWNLOAD] STA connect failed");
@@ -720,14 +723,19 @@ bool downloadFileFromRoot(const String& remotePath, const String& localPath) {
     return false;
   }
 
-  // Ensure directory exists
-  int lastSlash = localPath.lastIndexOf('/');
-  if (lastSlash > 0) {
-    String dir = localPath.substring(0, lastSlash);
-    ensureDir(dir.c_str());
+  // SD bus lock μόνο γύρω από τις εγγραφές, όχι όσο περιμένουμε το network
+  // (ένας collector μπορεί να κατεβάζει .hex ενώ τρέχει άλλο FW job)
+  FsFile f;
+  {
+    SdBusGuard sdBus;
+    // Ensure directory exists
+    int lastSlash = localPath.lastIndexOf('/');
+    if (lastSlash > 0) {
+      String dir = localPath.substring(0, lastSlash);
+      ensureDir(dir.c_str());
+    }
+    f = sd.open(localPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC);
   }
-
-  FsFile f = sd.open(localPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC);
   if (!f) {
     Serial.printf("[DOWNLOAD] Cannot create %s\n", localPath.c_str());
     client.stop();
@@ -736,10 +744,12 @@ bool downloadFileFromRoot(const String& remotePath, const String& localPath) {
 
   int bytesReceived = 0;
   while (client.connected() || client.available()) {
+    esp_task_wdt_reset();  // main loop ή sensor_jobs task (.hex που λείπει)
     if (client.available()) {
       uint8_t buf[512];
       int len = client.read(buf, sizeof(buf));
       if (len > 0) {
+        SdBusGuard sdBus;
         f.write(buf, len);
         bytesReceived += len;
       }
@@ -747,7 +757,10 @@ bool downloadFileFromRoot(const String& remotePath, const String& localPath) {
     delay(1);
   }
   
-  f.close();
+  {
+    SdBusGuard sdBus;
+    f.close();
+  }
   client.stop();
   
   Serial.printf("[DOWNLOAD] Downloaded %s (%d bytes) -> %s\n", 
@@ -755,13 +768,119 @@ bool downloadFileFromRoot(const String& remotePath, const String& localPath) {
   return bytesReceived > 0;
 }
 
+// Collector: POST /jobs/since/<version> -> response στο localPath
+// Γυρίζει το HTTP status (-1 αν δεν υπήρξε response)
+// =============================
+static int postJobSync(uint32_t since, const String& body, const char* localPath) {
+  if (WiFi.getMode() == WIFI_OFF) WiFi.mode(WIFI_STA);
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.printf("[SYNC] Connecting STA to %s...\n", config.uplinkSSID.c_str());
+    WiFi.begin(config.uplinkSSID.c_str(), config.uplinkPASS.c_str());
+    unsigned long t0 = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - t0 < 10000) { delay(200); }
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("[SYNC] STA connect failed");
+    return -1;
+  }
+
+  String targetHost = config.uplinkHost;
+  if (targetHost.length() == 0 || targetHost == "Auto" || targetHost == "auto") {
+    targetHost = WiFi.gatewayIP().toString();
+  }
+
+  WiFiClient client;
+  if (!client.connect(targetHost.c_str(), config.uplinkPort)) {
+    Serial.println("[SYNC] Connect failed");
+    return -1;
+  }
+
+  String request = "POST /jobs/since/" + String((unsigned long)since) + " HTTP/1.1\r\n";
+  request += "Host: " + targetHost + "\r\n";
+  request += "Connection: close\r\nContent-Type: text/plain\r\n";
+  request += "Content-Length: " + String(body.length()) + "\r\n\r\n";
+  client.print(request);
+  if (body.length() > 0) client.print(body);
+
+  unsigned long t0 = millis();
+  while (client.connected() && !client.available() && millis() - t0 < 10000) {
+    delay(10);
+  }
+  if (!client.available()) {
+    Serial.println("[SYNC] No response");
+    client.stop();
+    return -1;
+  }
+
+  int status = -1;
+  while (client.available()) {
+    String line = client.readStringUntil('\n');
+    line.trim();
+    if (line.startsWith("HTTP/")) {
+      int sp = line.indexOf(' ');
+      if (sp > 0) status = line.substring(sp + 1).toInt();
+    }
+    if (line.length() == 0) break;
+  }
+  if (status != 200) {
+    client.stop();
+    return status;
+  }
+
+  FsFile f = sd.open(localPath, O_WRONLY | O_CREAT | O_TRUNC);
+  if (!f) {
+    client.stop();
+    return -1;
+  }
+  while (client.connected() || client.available()) {
+    if (client.available()) {
+      uint8_t buf[512];
+      int len = client.read(buf, sizeof(buf));
+      if (len > 0) f.write(buf, len);
+    }
+    delay(1);
+  }
+  f.close();
+  client.stop();
+  return status;
+}
+
 // Collector: Sync jobs from root
+// Πρώτα incremental (/jobs/since), ολόκληρα αρχεία μόνο αν ο root δεν το υποστηρίζει
 // =============================
 static void syncJobsFromRoot() {
   if (config.role != ROLE_COLLECTOR) return;
-  
+  if (!initSdCard()) return;
+  ensureDir("/jobs");
+
   Serial.println("[SYNC] Syncing jobs from root...");
-  
+
+  uint32_t since = jsync_version();
+  bool legacy = false;
+  for (int round = 0; round < JOB_SYNC_MAX_ROUNDS; ++round) {
+    String outbox;
+    jsync_outbox(outbox);
+    int status = postJobSync(since, outbox, JSYNC_RESPONSE_PATH);
+    if (status == 404) {
+      legacy = true;
+      break;
+    }
+    uint32_t version = since;
+    bool more = false;
+    if (status != 200 || !jsync_applyResponse(JSYNC_RESPONSE_PATH, version, more)) {
+      Serial.printf("[SYNC] Incremental sync failed (HTTP %d), retry next wake\n", status);
+      break;
+    }
+    jsync_commit(version, outbox.length());
+    since = version;
+    if (!more && !jsync_outbox(outbox)) break;
+  }
+  Serial.printf("[SYNC] Jobs at version %lu\n", (unsigned long)since);
+  if (!legacy) return;
+
+  // Παλιός root χωρίς journal
+  Serial.println("[SYNC] Root has no /jobs/since, downloading full job files");
+
   // Download config jobs
   bool cfgOk = downloadFileFromRoot("/jobs/config_jobs.json", "/jobs/config_jobs.json");
   if (cfgOk) {
@@ -801,147 +920,6 @@ void processQueue() {
   }
 }
 
-// =============================
-// JOB EXECUTION (JSON-based)
-// =============================
-
-// very small helper to do one HTTP GET (for STATUS / CONFIGURE)
-static bool doSimpleHttpGet(const String& url, String& bodyOut, unsigned long timeoutMs = 5000) {
-  Serial.printf("[HTTP] GET %s\n", url.c_str());
-  WiFiClient client;
-  // Extract host & path from full URL "http://x.x.x.x/....."
-  String host, path;
-  if (url.startsWith("http://")) {
-    int hostStart = 7;
-    int slash = url.indexOf('/', hostStart);
-    if (slash < 0) slash = url.length();
-    host = url.substring(hostStart, slash);
-    path = (slash < (int)url.length()) ? url.substring(slash) : "/";
-  } else {
-    Serial.println("[HTTP] URL must start with http://");
-    return false;
-  }
-
-  if (!client.connect(host.c_str(), 80)) {
-    Serial.println("[HTTP] connect() failed");
-    return false;
-  }
-
-  client.print(String("GET ") + path + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n\r\n");
-
-  unsigned long t0 = millis();
-  while (client.connected() && !client.available() && (millis() - t0) < timeoutMs) {
-    delay(10);
-  }
-  if (!client.available()) {
-    Serial.println("[HTTP] no data");
-    client.stop();
-    return false;
-  }
-
-  String resp;
-  while (client.available()) {
-    resp += (char)client.read();
-  }
-  client.stop();
-
-  int bodyIndex = resp.indexOf("\r\n\r\n");
-  if (bodyIndex >= 0) {
-    bodyOut = resp.substring(bodyIndex + 4);
-  } else {
-    bodyOut = resp;
-  }
-  return true;
-}
-
-// Execute a single JSON job from JOB_FILE; returns true if a job was found & executed
-static bool processSingleJobIfAny() {
-  if (!initSdCard()) return false;
-  if (!sd.exists(JOB_FILE)) return false;
-
-  FsFile f = sd.open(JOB_FILE, O_RDONLY);
-  if (!f) {
-    Serial.println("[JOBS] Failed to open job file");
-    return false;
-  }
-
-  String json;
-  while (f.available()) {
-    json += (char)f.read();
-  }
-  f.close();
-
-  StaticJsonDocument<8192> doc;
-  DeserializationError err = deserializeJson(doc, json);
-  if (err) {
-    Serial.printf("[JOBS] JSON parse error: %s\n", err.c_str());
-    return false;
-  }
-
-  const char* type = doc["type"] | "";
-  String sensorIp = doc["sensor_ip"] | "";
-  String sensorSn = doc["sensor_sn"] | "";
-  if (sensorIp.length() == 0) {
-    // fallback if only host is provided
-    sensorIp = "192.168.4.2";
-  }
-
-  if (strlen(type) == 0) {
-    Serial.println("[JOBS] Missing 'type' in job");
-    return false;
-  }
-
-  // Common epoch in ms (like python)
-  unsigned long epoch_ms = millis();  // locally we don't have RTC epoch necessarily
-
-  if (strcmp(type, "STATUS") == 0) {
-    String url = String("http://") + sensorIp + "/api?command=STATUS&datetime=" + String(epoch_ms) + "&";
-    String body;
-    if (!doSimpleHttpGet(url, body)) {
-      Serial.println("[JOBS] STATUS command failed");
-      return true;  // job existed, we tried
-    }
-    Serial.printf("[JOBS] STATUS response body:\n%s\n", body.c_str());
-  } else if (strcmp(type, "CONFIGURE") == 0) {
-    String url = String("http://") + sensorIp + "/api?command=CONFIGURE&datetime=" + String(epoch_ms) + "&";
-
-    JsonObject params = doc["params"].as<JsonObject>();
-    for (JsonPair kv : params) {
-      const char* k = kv.key().c_str();
-      String v = kv.value().as<String>();
-      url += String(k) + "=" + v + "&";
-    }
-    String body;
-    if (!doSimpleHttpGet(url, body)) {
-      Serial.println("[JOBS] CONFIGURE command failed");
-      return true;
-    }
-    Serial.printf("[JOBS] CONFIGURE response body:\n%s\n", body.c_str());
-  } else if (strcmp(type, "FIRMWARE_UPDATE") == 0) {
-    String hexPath = doc["hex_path"] | "/firmware/vibration_sensor_app_v1.17.hex";
-
-    FirmwareJob job;
-    job.sensorIp = sensorIp;
-    job.sensorSN = sensorSn;
-    job.hexPath = hexPath;
-    job.maxLines = doc["max_lines"] | 0;                             // 0 => all
-    job.totalTimeoutMs = doc["timeout_ms"] | (8UL * 60UL * 1000UL);  // default 8 minutes
-
-    bool ok = executeFirmwareJob(job);
-    Serial.printf("[JOBS] Firmware update job finished -> %s\n", ok ? "OK" : "FAIL");
-  } else {
-    Serial.printf("[JOBS] Unknown job type: %s\n", type);
-  }
-
-  // rename job so that it doesn't run again
-  String doneName = String(JOB_FILE) + ".done";
-  if (sd.exists(doneName.c_str())) {
-    sd.remove(doneName.c_str());
-  }
-  sd.rename(JOB_FILE, doneName.c_str());
-  return true;
-}
-
 // =============================
 // Time Initialization
 // =============================
@@ -986,6 +964,11 @@ void startOperationalMode() {
   initializeTime();
   debugPrintTime("After initializeTime()");
 
+  // Πριν από το πρώτο BLEDevice::init: ο controller δεν θα χρειαστεί Classic BT
+  if (config.bleBeaconEnabled && config.role != ROLE_ROOT) {
+    ble_releaseClassicMemory();
+  }
+
   esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
   if (cause == ESP_SLEEP_WAKEUP_TIMER) {
     currentState = rtc_next_state;
@@ -997,11 +980,110 @@ void startOperationalMode() {
   Serial.println("[OPMODE] Started.");
 }
 
+// =============================
+// Parent cache (BLE discovery)
+// =============================
+static bool connectUplink(const char* ssid, unsigned long timeoutMs) {
+  if (WiFi.getMode() == WIFI_OFF) WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, config.uplinkPASS.c_str());
+  unsigned long t0 = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - t0 < timeoutMs) { delay(100); }
+  return WiFi.status() == WL_CONNECTED;
+}
+
+// Cache hit: σύνδεση στον parent του προηγούμενου window χωρίς BLE.
+// false => scan (cache άδειο, ώρα για έλεγχο, ή ο parent δεν απαντά).
+static bool parentFromCache() {
+  if (!rtc_parent.valid) return false;
+  if (rtc_parent.cyclesSinceScan >= PARENT_CACHE_RESCAN_CYCLES) {
+    Serial.printf("[BLE-MESH] Parent cache: periodic rescan after %u cycles\n",
+                  (unsigned)rtc_parent.cyclesSinceScan);
+    return false;
+  }
+  unsigned long t0 = millis();
+  if (!connectUplink(rtc_parent.ssid, PARENT_CACHE_CONNECT_MS)) {
+    Serial.printf("[BLE-MESH] Cached parent %s not reachable, rescanning\n", rtc_parent.ssid);
+    WiFi.disconnect();
+    rtc_parent.valid = false;
+    return false;
+  }
+  time(&rtc_parent.lastSuccess);
+  rtc_parent.cyclesSinceScan++;
+  config.uplinkSSID = rtc_parent.ssid;
+  Serial.printf("[BLE-MESH] Parent cache hit: %s (RSSI %d at scan, connected in %lu ms)\n",
+                rtc_parent.ssid, rtc_parent.rssi, millis() - t0);
+  return true;
+}
+
+static void parentFromScan() {
+  String scannerName = config.nodeName + "_Scanner";
+  bleScanner.begin(scannerName);
+  BLEScannerManager::ScanResult result = bleScanner.scanForParent(config.bleScanDurationSec);
+  bleScanner.stop();
+
+  // Ώρα από τα advertisements: χωρίς WiFi/HTTP /time
+  time_t nowLocal;
+  time(&nowLocal);
+  if (result.timeValid && (needToSyncTime || nowLocal < 1700000000UL) &&
+      result.timeAccuracy <= BLE_TIME_MAX_ACCURACY_S) {
+    uint32_t age = millis() - result.timeAtMillis;
+    struct timeval tv;
+    tv.tv_sec = (time_t)(result.epoch + age / 1000);
+    tv.tv_usec = (suseconds_t)(age % 1000) * 1000;
+    settimeofday(&tv, NULL);
+    persistRtcTime(tv.tv_sec);
+    needToSyncTime = false;
+    Serial.printf("[TIME] Synced from BLE beacon: %lu (±%u s, was %ld s off)\n",
+                  (unsigned long)tv.tv_sec, (unsigned)result.timeAccuracy,
+                  (long)(nowLocal - tv.tv_sec));
+  }
+
+  if (!result.found) {
+    Serial.println("[BLE-MESH] No parent found via BLE, proceeding with configured uplink");
+    return;
+  }
+  if (result.apSSID.length() == 0) {
+    // Χωρίς SSID δεν αλλάζουμε ούτε το uplink ούτε το cache
+    Serial.println("[BLE-MESH] Parent without AP SSID, proceeding with configured uplink");
+    return;
+  }
+  Serial.printf("[BLE-MESH] Found parent SSID: %s (Role: %s, RSSI: %d dBm)\n",
+               result.apSSID.c_str(),
+               result.nodeRole == 1 ? "Root" : "Repeater",
+               result.rssi);
+  // Override uplinkSSID with discovered AP SSID from BLE
+  config.uplinkSSID = result.apSSID;
+  Serial.printf("[BLE-MESH] Using discovered AP SSID for WiFi: %s\n", config.uplinkSSID.c_str());
+
+  // Στο cache χωρίς lastSuccess: επιβεβαιώνεται στο connect του επόμενου window
+  memset(&rtc_parent, 0, sizeof(rtc_parent));
+  strncpy(rtc_parent.ssid, result.apSSID.c_str(), sizeof(rtc_parent.ssid) - 1);
+  unsigned a[6];
+  if (sscanf(result.address.c_str(), "%x:%x:%x:%x:%x:%x", &a[0], &a[1], &a[2], &a[3], &a[4], &a[5]) == 6) {
+    for (int i = 0; i < 6; i++) rtc_parent.bleAddr[i] = (uint8_t)a[i];
+  }
+  rtc_parent.rssi = (int8_t)constrain(result.rssi, -128, 127);
+  rtc_parent.role = result.nodeRole;
+  rtc_parent.valid = true;
+}
+
 // =============================
 // Deep Sleep & Scheduler
 // =============================
 void stopAPMode() {
   if (apActive) {
+    sjm_abortJobs();
+    shttp_abortAll();
+    sjm_compactJobs(true);
+    hbLog.end();
+    const HeartbeatStats& hb = heartbeatManager.stats();
+#if HB_ALLOC_AUDIT
+    Serial.printf("[HB] %lu heartbeats this session, %lu touched the heap (max %ld blocks)\n",
+                  (unsigned long)hb.heartbeats, (unsigned long)hb.allocatingHeartbeats,
+                  (long)hb.maxBlockDelta);
+#else
+    Serial.printf("[HB] %lu heartbeats this session\n", (unsigned long)hb.heartbeats);
+#endif
     if (stationConnectedEventId) {
       WiFi.removeEvent(stationConnectedEventId);
       stationConnectedEventId = 0;
@@ -1028,9 +1110,10 @@ void goToDeepSleep(unsigned int seconds) {
   rtc_last_sleep_duration_s = seconds;
   stopAPMode();
   
-  // Stop BLE before deep sleep
+  // Stop BLE before deep sleep (και τον resident controller του scanner)
   if (config.bleBeaconEnabled) {
     bleBeacon.stop();
+    ble_shutdown();
     Serial.println("[BLE-MESH] Stopped BLE beacon before sleep");
   }
   
@@ -1122,6 +1205,7 @@ void loopOperationalMode() {
   if (config.role == ROLE_ROOT) {
     ensureWiFiAPRoot();
     ensureRootHttpServer();
+    jsync_rootPoll();
     
     // Root doesn't need BLE - always on and accessible via WiFi
     
@@ -1138,21 +1222,62 @@ void loopOperationalMode() {
     ensureWiFiAPRepeater();
     ensureRepeaterHttpServer();
     
-    // Repeater uses continuous BLE beacon with light sleep (not deep sleep)
-    // This allows collectors to find and wake it at any time
-    if (config.bleBeaconEnabled && !bleBeacon.isActive()) {
+    // Repeater uses a BLE beacon with light sleep (not deep sleep).
+    // Το interval του advertising το ορίζει ο bleAdvScheduler παρακάτω.
+    if (config.bleBeaconEnabled && !bleBeacon.isReady()) {
       // Use actual AP SSID (same logic as ensureWiFiAPRepeater)
       String actualAPSSID = config.apSSID.length() ? config.apSSID : String("Repeater_AP");
       bleBeacon.begin(actualAPSSID, config.nodeName, 0); // 0 = Repeater role
       bleBeacon.startAdvertising();
-      Serial.println("[BLE-MESH] Repeater BLE beacon active (continuous with light sleep)");
+      Serial.println("[BLE-MESH] Repeater BLE beacon active (adaptive interval, light sleep)");
+    }
+
+    // Φορτίο/uplink στο beacon, ώστε οι collectors να διαλέγουν parent με cost
+    static unsigned long lastBeaconInfo = 0;
+    static uint8_t lastStations = 0;
+    if (bleBeacon.isReady() && millis() - lastBeaconInfo > MESH_BEACON_REFRESH_MS) {
+      lastBeaconInfo = millis();
+      MeshBeaconInfo info = bleBeacon.currentInfo();
+      uint8_t stations = WiFi.softAPgetStationNum();
+      if (stations > lastStations) {
+        time_t now;
+        time(&now);
+        if (now > 1700000000UL) bleAdvScheduler.noteArrival(now, config.meshIntervalMin * 60);
+      }
+      lastStations = stations;
+      info.hops = config.uplinkRoute == UPLINK_DIRECT ? 1 : 2;
+      info.stations = stations;
+      info.freeSlots = stations < MESH_AP_MAX_STATIONS ? MESH_AP_MAX_STATIONS - stations : 0;
+      info.uplinkRssi = WiFi.status() == WL_CONNECTED ? (int8_t)WiFi.RSSI() : 0;
+      bleBeacon.updateInfo(info);
     }
     
+    // Sync στην αρχή και ξανά όταν το drift χαλάσει την ώρα που δίνουμε στο BLE
     static bool tried = false;
-    if (!tried) {
+    static unsigned long lastTimeSync = 0;
+    if (!tried || (currentTimeAccuracy() > MESH_TIME_RESYNC_ACCURACY_S &&
+                   millis() - lastTimeSync > MESH_TIME_RESYNC_RETRY_MS)) {
       tried = true;
+      lastTimeSync = millis();
       syncTimeFromUplink(5000);
     }
+
+    // Ώρα στο advertisement, για collectors χωρίς ρολόι
+    static unsigned long lastBeaconTime = 0;
+    if (bleBeacon.isReady() && millis() - lastBeaconTime > MESH_TIME_REFRESH_MS) {
+      lastBeaconTime = millis();
+      time_t now;
+      time(&now);
+      uint8_t acc = currentTimeAccuracy();
+      if (acc != MESH_TIME_UNKNOWN) {
+        // + η παλαιότητα του advertisement και το κόψιμο σε δευτερόλεπτα
+        acc = (uint8_t)min<uint32_t>(acc + MESH_TIME_REFRESH_MS / 1000 + 1, MESH_TIME_UNKNOWN - 1);
+      }
+      bleBeacon.updateTime((uint32_t)now, now > 1700000000UL ? acc : MESH_TIME_UNKNOWN);
+
+      // Fast advertising μόνο όταν περιμένουμε collectors
+      bleBeacon.setAdvInterval(bleAdvScheduler.intervalFor(now, config.meshIntervalMin * 60));
+    }
     // Repeater stays in light sleep with BLE beacon active
     // No deep sleep - allows instant wake-up when collector connects
   }
@@ -1190,6 +1315,8 @@ void loopOperationalMode() {
 
           // Reset job cache for new AP session
           sjm_resetJobCache();
+          sjm_init();
+          hbLog.begin();
 
           setStatusLed(STATUS_WIFI_ACTIVITY);
           Serial.println("[STATE] Executing: COLLECTOR AP");
@@ -1215,6 +1342,8 @@ void loopOperationalMode() {
 
                 hadStation = true;
                 lastActivityMillis = millis();
+                // Πίνακας stations: STATUS μετά το grace period, από το main loop
+                sjm_stationConnected(info.wifi_ap_staconnected.mac);
 
                 char macStr[20];
                 sprintf(macStr, "%02x:%02x:%02x:%02x:%02x:%02x",
@@ -1228,7 +1357,12 @@ void loopOperationalMode() {
                 Serial.printf("[AP] Station connected: %s (waiting for heartbeat POST)\n", macStr);
               }
 
+              else if (event == ARDUINO_EVENT_WIFI_AP_STAIPASSIGNED) {
+                sjm_stationIpAssigned(info);
+              }
+
               else if (event == ARDUINO_EVENT_WIFI_AP_STADISCONNECTED) {
+                sjm_stationDisconnected(info.wifi_ap_stadisconnected.mac);
                 Serial.println("[AP] Station disconnected.");
               }
             });
@@ -1250,17 +1384,17 @@ void loopOperationalMode() {
           // ======================================================
 
           // ΧΡΗΣΙΜΟΠΟΙΟΥΜΕ ΤΟ GLOBAL sensorServer
-          heartbeatManager.begin(sensorServer);
+          heartbeatManager.begin(sensorServer, sensorBodyArena);
 
           // -------- STATUS (heartbeats_after_measurement = 1)
           // When sensor sends a heartbeat with value=1, send STATUS command to get full status
           heartbeatManager.onStatus([](const SensorHeartbeatContext& ctx) {
             // Buffer for main loop processing (safe - no FreeRTOS)
-            Serial.printf("[HB] STATUS heartbeat received for SN=%s IP=%s\n",
-                          ctx.sensorSn.c_str(),
-                          ctx.lastIp.toString().c_str());
+            // Σύντομο format: το printf κάνει malloc πάνω από 64 bytes
+            Serial.printf("[HB] STATUS SN=%s IP=%u.%u.%u.%u\n", ctx.sensorSn,
+                          ctx.lastIp[0], ctx.lastIp[1], ctx.lastIp[2], ctx.lastIp[3]);
             
-            bufferHeartbeat(ctx.sensorSn, ctx.lastIp.toString(), false);
+            bufferHeartbeat(ctx.sensorSn, (uint32_t)ctx.lastIp, false);
             lastActivityMillis = millis();
           });
 
@@ -1268,11 +1402,11 @@ void loopOperationalMode() {
           // When sensor sends heartbeat with value>1, check for and execute jobs
           heartbeatManager.onOther([](const SensorHeartbeatContext& ctx) {
             // Buffer for main loop processing with job check (safe - no FreeRTOS)
-            Serial.printf("[HB] OTHER heartbeat received for SN=%s IP=%s\n",
-                          ctx.sensorSn.c_str(),
-                          ctx.lastIp.toString().c_str());
+            // Σύντομο format: το printf κάνει malloc πάνω από 64 bytes
+            Serial.printf("[HB] OTHER SN=%s IP=%u.%u.%u.%u\n", ctx.sensorSn,
+                          ctx.lastIp[0], ctx.lastIp[1], ctx.lastIp[2], ctx.lastIp[3]);
             
-            bufferHeartbeat(ctx.sensorSn, ctx.lastIp.toString(), true);
+            bufferHeartbeat(ctx.sensorSn, (uint32_t)ctx.lastIp, true);
             lastActivityMillis = millis();
           });
 
@@ -1297,7 +1431,7 @@ void loopOperationalMode() {
                          sensorSn.c_str(), remoteIp.toString().c_str());
             
             // Buffer with job check enabled - main loop will process
-            bufferHeartbeat(sensorSn, remoteIp.toString(), true);
+            bufferHeartbeat(sensorSn.c_str(), (uint32_t)remoteIp, true);
             
             request->send(200, "text/plain", "OK");
             lastActivityMillis = millis();
@@ -1313,11 +1447,26 @@ void loopOperationalMode() {
             },
             nullptr,
             [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-              if (index != 0 && index + len != total) return;
+              uint8_t* body;
+              size_t bodyLen;
+              switch (sensorBodyArena.feed(request, data, len, index, total, STATUS_MAX_BODY, body, bodyLen)) {
+                case BodyArena::BODY_COMPLETE:
+                  break;
+                case BodyArena::BODY_TOO_LARGE:
+                  request->send(413, "text/plain", "Body too large");
+                  return;
+                case BodyArena::BODY_BUSY:
+                  request->send(503, "text/plain", "Busy");
+                  return;
+                default:
+                  return;
+              }
               
-              DynamicJsonDocument doc(1024);
-              DeserializationError err = deserializeJson(doc, data, len);
+              // Parse εδώ: στο hbBuffer περνάνε μόνο τα πεδία του record, όχι το body
+              DynamicJsonDocument doc(STATUS_MAX_BODY + 256);
+              DeserializationError err = deserializeJson(doc, (const uint8_t*)body, bodyLen);
               if (err) {
+                sensorBodyArena.release(request);
                 request->send(400, "text/plain", "Invalid JSON");
                 return;
               }
@@ -1342,10 +1491,13 @@ void loopOperationalMode() {
               
               // Log to Serial
               Serial.printf("[HB-LEGACY] POST /api/status from SN=%s IP=%s (%d bytes)\n", 
-                           sensorSn.c_str(), remoteIp.toString().c_str(), (int)len);
+                           sensorSn.c_str(), remoteIp.toString().c_str(), (int)bodyLen);
               
-              // Buffer heartbeat with status data - main loop will save to SD
-              bufferHeartbeat(sensorSn, remoteIp.toString(), false, data, len);
+              // Buffer heartbeat with status fields - main loop will save to SD
+              StatusLogFields status;
+              HeartbeatLogger::parseStatus(dataStr.c_str(), status);
+              bufferHeartbeat(sensorSn.c_str(), (uint32_t)remoteIp, false, &status);
+              sensorBodyArena.release(request);
               
               request->send(200, "text/plain", "OK");
               lastActivityMillis = millis();
@@ -1397,6 +1549,32 @@ void loopOperationalMode() {
         // ---- PROCESS BUFFERED HEARTBEATS (SD writes and job execution) ----
         // This runs in main loop context where SD and job operations are safe
         processHeartbeatBuffer();
+        hbLog.poll();
+
+        // ---- SENSOR JOBS (FW/CONFIG, παράλληλα στο "sensor_jobs" task) ----
+        sjm_processStations();
+        shttp_poll();
+        sjm_pollJobs();
+        if (sjm_jobsActive() > 0 || shttp_inFlight() > 0) {
+          // Ένα update που τρέχει μετράει σαν activity, να μην κλείσει το AP
+          lastActivityMillis = millis();
+
+          static unsigned long lastProgressLog = 0;
+          if (millis() - lastProgressLog > 10000) {
+            lastProgressLog = millis();
+            SensorJobProgress progress[MAX_PARALLEL_SENSOR_JOBS];
+            int n = sjm_jobProgress(progress, MAX_PARALLEL_SENSOR_JOBS);
+            for (int i = 0; i < n; ++i) {
+              if (progress[i].kind == 'f') {
+                Serial.printf("[JOBS] SN=%s firmware: %lu records in %lu s\n", progress[i].sn,
+                              (unsigned long)progress[i].records, (unsigned long)(progress[i].elapsedMs / 1000));
+              }
+            }
+          }
+        } else if (millis() - lastHeartbeatMillis > JOB_COMPACT_IDLE_MS) {
+          // Ήσυχο διάστημα: τα ολοκληρωμένα jobs φεύγουν από τα job files
+          sjm_compactJobs();
+        }
 
         // ---- TIMEOUT CHECK ----
         // Check for any sensor activity (heartbeats OR data transfers) periodically
@@ -1461,26 +1639,19 @@ void loopOperationalMode() {
           Serial.printf("[STATE] Executing: UPLINK APPOINTMENT (%s)\n",
                         (config.role == ROLE_REPEATER ? "REPEATER" : "COLLECTOR"));
 
-          // BLE Scan for parent discovery (Collector/Repeater finding their parent)
+          // BLE Scan for parent discovery (Collector/Repeater finding their parent).
+          // Ο parent σπάνια αλλάζει: πρώτα ο cached, scan μόνο αν δεν απαντά.
           if (config.bleBeaconEnabled && !bleScanned) {
-            Serial.println("[BLE-MESH] Scanning for parent node...");
-            String scannerName = config.nodeName + "_Scanner";
-            bleScanner.begin(scannerName);
-            BLEScannerManager::ScanResult result = bleScanner.scanForParent(config.bleScanDurationSec);
-            bleScanner.stop();
-            bleScanned = true;
-            
-            if (result.found) {
-              Serial.printf("[BLE-MESH] Found parent SSID: %s (Role: %s, RSSI: %d dBm)\n",
-                           result.apSSID.c_str(),
-                           result.nodeRole == 1 ? "Root" : "Repeater",
-                           result.rssi);
-              // Override uplinkSSID with discovered AP SSID from BLE
-              config.uplinkSSID = result.apSSID;
-              Serial.printf("[BLE-MESH] Using discovered AP SSID for WiFi: %s\n", config.uplinkSSID.c_str());
+            if (parentFromCache()) {
+              rtc_parent_hits++;
             } else {
-              Serial.println("[BLE-MESH] No parent found via BLE, proceeding with configured uplink");
+              rtc_parent_misses++;
+              Serial.println("[BLE-MESH] Scanning for parent node...");
+              parentFromScan();
             }
+            bleScanned = true;
+            Serial.printf("[BLE-MESH] Parent cache: %lu hits, %lu misses\n",
+                          (unsigned long)rtc_parent_hits, (unsigned long)rtc_parent_misses);
           }
 
           time(&state_start_time);
@@ -2,16 +2,32 @@
 #define SENSOR_HEARTBEAT_MANAGER_H
 
 #include <Arduino.h>
-#include <vector>
 #include <functional>
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
-
+#include "sensor_registry.h"
+#include "body_arena.h"
+#if HB_ALLOC_AUDIT
+#include <esp_heap_caps.h>
+#endif
+
+// Context ενός heartbeat, φτιάχνεται στο stack από το record του
+// sensor_registry (ή μόνο από το request αν το SN δεν είναι αριθμός)
 struct SensorHeartbeatContext {
-    String sensorSn;
+    char sensorSn[24];
     IPAddress lastIp;
     int heartbeatsAfterMeasurement = 1;  // simplified semantics
-    String lastFirmwareVersion;          // optional
+};
+
+// Μετρητές του /event/heartbeat. allocatingHeartbeats = heartbeats όπου ο
+// αριθμός heap blocks άλλαξε μέσα στην κλήση του τελευταίου chunk, από την
+// αρχή της ως πριν το send (HB_ALLOC_AUDIT). Τα προηγούμενα chunks (arena)
+// δεν μετράνε. Άλλα tasks μπορεί να κάνουν malloc ταυτόχρονα, οπότε είναι
+// άνω όριο· σε ήσυχο AP πρέπει να μένει 0.
+struct HeartbeatStats {
+    uint32_t heartbeats = 0;
+    uint32_t allocatingHeartbeats = 0;
+    int32_t maxBlockDelta = 0;
 };
 
 class SensorHeartbeatManager {
@@ -19,7 +35,8 @@ public:
     using StatusCallback = std::function<void(const SensorHeartbeatContext&)>;
     using OtherCommandCallback = std::function<void(const SensorHeartbeatContext&)>;
 
-    void begin(AsyncWebServer& server) {
+    void begin(AsyncWebServer& server, BodyArena& bodyArena) {
+        arena = &bodyArena;
         // /event/heartbeat όπως στο sensorsdaemon (POST με JSON)
         server.on(
             "/event/heartbeat",
@@ -47,93 +64,136 @@ public:
 
     void onStatus(StatusCallback cb) { statusCb = cb; }
     void onOther(OtherCommandCallback cb) { otherCb = cb; }
+    const HeartbeatStats& stats() const { return hbStats; }
 
 private:
-    std::vector<SensorHeartbeatContext> sensors;
+    BodyArena* arena = nullptr;
+    // Ένα parse τη φορά (AsyncTCP task), οπότε ένα σταθερό document αρκεί
+    StaticJsonDocument<512> parseDoc;
+    HeartbeatStats hbStats;
     StatusCallback statusCb;
     OtherCommandCallback otherCb;
 
-    SensorHeartbeatContext* findOrCreate(const String& sn, const IPAddress& ip) {
-        for (auto &s : sensors) {
-            if (s.sensorSn == sn) {
-                s.lastIp = ip;
-                return &s;
-            }
-        }
-        SensorHeartbeatContext ctx;
-        ctx.sensorSn = sn;
+    // Registry lookup (O(1), RTC memory) + ενημέρωση IP και, αν ήρθε,
+    // heartbeats_after_measurement. false αν το SN δεν χωράει στο context.
+    static bool resolve(const char* sn, const IPAddress& ip, int hbAfter,
+                        SensorHeartbeatContext& ctx) {
+        size_t n = strlen(sn);
+        if (n >= sizeof(ctx.sensorSn)) return false;
+        memcpy(ctx.sensorSn, sn, n + 1);
         ctx.lastIp = ip;
-        sensors.push_back(ctx);
-        return &sensors.back();
+
+        uint32_t key;
+        SensorRecord* rec = sreg_parseSn(sn, key) ? sreg_touch(key) : nullptr;
+        if (!rec) {
+            // Μη αριθμητικό SN: μόνο για αυτό το heartbeat, όπως πριν το registry
+            if (hbAfter >= 0) ctx.heartbeatsAfterMeasurement = hbAfter;
+            return true;
+        }
+        rec->ip = (uint32_t)ip;
+        if (hbAfter >= 0) rec->heartbeatsAfterMeasurement = (int16_t)hbAfter;
+        ctx.heartbeatsAfterMeasurement = rec->heartbeatsAfterMeasurement;
+        return true;
+    }
+
+    // Σταθερά responses: ίδια bytes με το serializeJson που έστελνε πριν,
+    // χωρίς String / JsonDocument ανά heartbeat
+    static void reply(AsyncWebServerRequest *request, int code, const char* body) {
+        static const String contentType("application/json");
+        request->send_P(code, contentType, body);
+    }
+
+#if HB_ALLOC_AUDIT
+    static int32_t heapBlocks() {
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+        return (int32_t)info.allocated_blocks;
     }
+#endif
 
     void handleHeartbeatBody(AsyncWebServerRequest *request,
                              uint8_t *data,
                              size_t len,
                              size_t index,
                              size_t total) {
-        // Για απλότητα: θέλουμε όλο το JSON σε ένα chunk (όπως κάνει συνήθως ο sensor).
-        // Αν έρθει σε πολλά chunks, αγνοούμε μέχρι να έρθει το τελευταίο.
-        if (index != 0) {
-            if (index + len != total) {
-                // περιμένουμε το τελευταίο chunk
+#if HB_ALLOC_AUDIT
+        int32_t blocksBefore = heapBlocks();
+#endif
+        // Το JSON μπορεί να έρθει σε πολλά chunks: το arena το ενώνει και
+        // το parse γίνεται μία φορά, στο τελευταίο
+        uint8_t* body;
+        size_t bodyLen;
+        switch (arena->feed(request, data, len, index, total, HEARTBEAT_MAX_BODY, body, bodyLen)) {
+            case BodyArena::BODY_COMPLETE:
+                break;
+            case BodyArena::BODY_TOO_LARGE:
+                reply(request, 413, "{\"success\":false,\"message\":\"body too large\"}");
+                return;
+            case BodyArena::BODY_BUSY:
+                reply(request, 503, "{\"success\":false,\"message\":\"busy, retry\"}");
+                return;
+            default:
                 return;
-            }
         }
 
-        DynamicJsonDocument doc(512);
-        DeserializationError err = deserializeJson(doc, data, len);
+        const char* response;
+        int code = process(body, bodyLen, request->client()->remoteIP(), response);
+        arena->release(request);
+
+#if HB_ALLOC_AUDIT
+        // Μόνο το δικό μας κομμάτι: το send κάνει new το response (βιβλιοθήκη)
+        int32_t delta = heapBlocks() - blocksBefore;
+        hbStats.heartbeats++;
+        if (delta != 0) hbStats.allocatingHeartbeats++;
+        if (delta > hbStats.maxBlockDelta) hbStats.maxBlockDelta = delta;
+#else
+        hbStats.heartbeats++;
+#endif
+        reply(request, code, response);
+    }
+
+    // Parse + registry + callbacks. Γυρίζει HTTP code και σταθερό response body.
+    int process(uint8_t* body, size_t bodyLen, const IPAddress& remoteIp, const char*& response) {
+        // Zero-copy: τα strings του doc δείχνουν στο body, που μένει άθικτο
+        // μέχρι το release (κανένα άλλο request δεν τρέχει στο AsyncTCP task)
+        DeserializationError err = deserializeJson(parseDoc, body, bodyLen);
         if (err) {
-            request->send(
-                400,
-                "application/json",
-                "{\"success\":false,\"message\":\"invalid json\"}"
-            );
-            return;
+            response = "{\"success\":false,\"message\":\"invalid json\"}";
+            return 400;
         }
 
-        String sensorSn = doc["sensor_sn"] | "";
-        if (sensorSn.isEmpty()) {
-            request->send(
-                400,
-                "application/json",
-                "{\"success\":false,\"message\":\"missing sensor_sn\"}"
-            );
-            return;
+        const char* sensorSn = parseDoc["sensor_sn"] | "";
+        if (sensorSn[0] == '\0') {
+            response = "{\"success\":false,\"message\":\"missing sensor_sn\"}";
+            return 400;
         }
 
-        IPAddress remoteIp = request->client()->remoteIP();
-        SensorHeartbeatContext* ctx = findOrCreate(sensorSn, remoteIp);
-
-        if (doc.containsKey("heartbeats_after_measurement")) {
-            ctx->heartbeatsAfterMeasurement =
-                doc["heartbeats_after_measurement"].as<int>();
+        JsonVariant hbVar = parseDoc["heartbeats_after_measurement"];
+        int hbAfter = hbVar.isNull() ? -1 : hbVar.as<int>();
+        SensorHeartbeatContext ctx;
+        if (!resolve(sensorSn, remoteIp, hbAfter, ctx)) {
+            response = "{\"success\":false,\"message\":\"invalid sensor_sn\"}";
+            return 400;
         }
 
-        String action = "ignored";
-
         // Απλοποιημένη λογική sensorsdaemon:
         // - 1  → STATUS
         // - >1 → Other (CONFIGURE / FW κλπ)
-        if (ctx->heartbeatsAfterMeasurement == 1) {
-            action = "Status Command";
+        if (ctx.heartbeatsAfterMeasurement == 1) {
             if (statusCb) {
-                statusCb(*ctx);
+                statusCb(ctx);
             }
-        } else if (ctx->heartbeatsAfterMeasurement > 1) {
-            action = "Other Command";
+            response = "{\"success\":true,\"message\":\"heartbeat processed, action: Status Command\"}";
+            return 200;
+        } else if (ctx.heartbeatsAfterMeasurement > 1) {
             if (otherCb) {
-                otherCb(*ctx);
+                otherCb(ctx);
             }
+            response = "{\"success\":true,\"message\":\"heartbeat processed, action: Other Command\"}";
+            return 200;
         }
-
-        DynamicJsonDocument resp(256);
-        resp["success"] = true;
-        resp["message"] = String("heartbeat processed, action: ") + action;
-
-        String out;
-        serializeJson(resp, out);
-        request->send(200, "application/json", out);
+        response = "{\"success\":true,\"message\":\"heartbeat processed, action: ignored\"}";
+        return 200;
     }
 };
 
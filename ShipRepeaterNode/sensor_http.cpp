@@ -0,0 +1,409 @@
+#include "sensor_http.h"
+#include "hex_line_reader.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <errno.h>
+
+void SensorHttpClient::setHost(const String& ip, bool keepAliveIn) {
+    if (ip != host) {
+        close();
+    }
+    host = ip;
+    keepAlive = keepAliveIn;
+    connects = 0;
+    status = 0;
+}
+
+// Όπως το WiFiClient::connect, αλλά χωρίς το select() με timeout:
+// το connect ολοκληρώνεται στο pollConnect()
+bool SensorHttpClient::startConnect() {
+    IPAddress ip;
+    if (!ip.fromString(host)) {
+        Serial.printf("[SENSOR-HTTP] ERROR: invalid sensor IP '%s'\n", host.c_str());
+        return false;
+    }
+    fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        Serial.printf("[SENSOR-HTTP] ERROR: socket() failed (%d)\n", errno);
+        return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(80);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        Serial.printf("[SENSOR-HTTP] ERROR: connect() to %s failed (%d)\n", host.c_str(), errno);
+        close();
+        return false;
+    }
+    connects++;
+    connectStartMs = millis();
+    phase = PHASE_CONNECTING;
+    return true;
+}
+
+bool SensorHttpClient::formatRequest() {
+    int n = snprintf(reqTail, sizeof(reqTail),
+                     " HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\n\r\n",
+                     host.c_str(), keepAlive ? "keep-alive" : "close");
+    if (!path || path[0] != '/' || n <= 0 || n >= (int)sizeof(reqTail)) {
+        Serial.println("[SENSOR-HTTP] ERROR: invalid request");
+        return false;
+    }
+    pathLen = strlen(path);
+    tailLen = (size_t)n;
+    reqSent = 0;
+    return true;
+}
+
+// Idle keep-alive connection που έκλεισε ο sensor (FIN ήδη στο socket)
+bool SensorHttpClient::peerClosed() {
+    uint8_t b;
+    int r = recv(fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    return r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+void SensorHttpClient::resetParser() {
+    hdrLen = 0;
+    inBody = false;
+    firstLine = true;
+    contentLength = -1;
+    bodyRead = 0;
+    bodyKept = 0;
+    status = 0;
+    peerWillClose = false;
+    gotFirstByte = false;
+    latencyMs = 0;
+    rttMs = 0;
+    if (bodyOut && bodyCap > 0) bodyOut[0] = '\0';
+}
+
+// false μόνο για λάθη που φαίνονται αμέσως (IP, socket, μήκος request).
+// Connect/send/response αποτυχίες έρχονται από το poll() ως SENSOR_HTTP_FAILED.
+bool SensorHttpClient::begin(const char* pathAndQuery, unsigned long timeout,
+                             char* body, size_t cap) {
+    path = pathAndQuery;
+    bodyOut = body;
+    bodyCap = cap;
+    timeoutMs = timeout;
+    startMs = millis();
+    resetParser();
+    if (!formatRequest()) {
+        return false;
+    }
+
+    if (fd >= 0 && peerClosed()) {
+        close();
+    }
+    reused = fd >= 0;
+    if (reused) {
+        phase = PHASE_SENDING;
+    } else if (!startConnect()) {
+        return false;
+    }
+    inFlight = true;
+    return true;
+}
+
+SensorHttpResult SensorHttpClient::fail() {
+    close();
+    if (reused) {
+        // Ο sensor έκλεισε το idle connection: ένα άμεσο reconnect, όχι retry
+        Serial.println("[SENSOR-HTTP] Keep-alive connection dropped, reconnecting");
+        reused = false;
+        resetParser();
+        reqSent = 0;
+        if (startConnect()) {
+            inFlight = true;
+            return SENSOR_HTTP_PENDING;
+        }
+    }
+    return SENSOR_HTTP_FAILED;
+}
+
+SensorHttpResult SensorHttpClient::pollConnect() {
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    struct timeval tv = { 0, 0 };
+    int r = select(fd + 1, nullptr, &wfds, nullptr, &tv);
+    if (r == 0) {
+        if (millis() - connectStartMs > SENSOR_HTTP_CONNECT_MS) {
+            Serial.printf("[SENSOR-HTTP] ERROR: connect() to %s timed out\n", host.c_str());
+            close();
+            return SENSOR_HTTP_FAILED;
+        }
+        return SENSOR_HTTP_PENDING;
+    }
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (r < 0 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+        Serial.printf("[SENSOR-HTTP] ERROR: connect() to %s failed (%d)\n", host.c_str(), err);
+        close();
+        return SENSOR_HTTP_FAILED;
+    }
+    phase = PHASE_SENDING;
+    return SENSOR_HTTP_PENDING;
+}
+
+SensorHttpResult SensorHttpClient::pollSend() {
+    static const char kGet[] = "GET ";
+    const char* parts[3] = { kGet, path, reqTail };
+    size_t lens[3] = { sizeof(kGet) - 1, pathLen, tailLen };
+
+    // Τα κομμάτια από το reqSent και μετά (μετά από partial send)
+    struct iovec iov[3];
+    int cnt = 0;
+    size_t skip = reqSent;
+    for (int i = 0; i < 3; i++) {
+        if (skip >= lens[i]) {
+            skip -= lens[i];
+            continue;
+        }
+        iov[cnt].iov_base = (void*)(parts[i] + skip);
+        iov[cnt].iov_len = lens[i] - skip;
+        skip = 0;
+        cnt++;
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = cnt;
+
+    ssize_t n = sendmsg(fd, &msg, MSG_DONTWAIT);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return SENSOR_HTTP_PENDING;
+        return fail();
+    }
+    reqSent += (size_t)n;
+    if (reqSent == lens[0] + lens[1] + lens[2]) phase = PHASE_RECEIVING;
+    return SENSOR_HTTP_PENDING;
+}
+
+SensorHttpResult SensorHttpClient::poll() {
+    if (!inFlight) {
+        return SENSOR_HTTP_FAILED;
+    }
+    if (millis() - startMs > timeoutMs) {
+        Serial.println(phase == PHASE_RECEIVING ? "[SENSOR-HTTP] ERROR: response timeout"
+                                                : "[SENSOR-HTTP] ERROR: request timeout");
+        close();
+        return SENSOR_HTTP_FAILED;
+    }
+
+    SensorHttpResult r = SENSOR_HTTP_PENDING;
+    if (phase == PHASE_CONNECTING) {
+        r = pollConnect();
+        if (r != SENSOR_HTTP_PENDING || phase == PHASE_CONNECTING) return r;
+    }
+    if (phase == PHASE_SENDING) {
+        r = pollSend();
+        if (r != SENSOR_HTTP_PENDING || phase != PHASE_RECEIVING) return r;
+    }
+    return pollReceive();
+}
+
+SensorHttpResult SensorHttpClient::pollReceive() {
+    uint8_t buf[256];
+    while (true) {
+        int rd = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (rd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return SENSOR_HTTP_PENDING;
+        }
+        if (rd <= 0) {
+            // Ο sensor έκλεισε τη σύνδεση (ή reset)
+            inFlight = false;
+            // Χωρίς Content-Length το body τελειώνει με το close
+            if (inBody && contentLength < 0) {
+                peerWillClose = true;
+                afterResponse();
+                return SENSOR_HTTP_DONE;
+            }
+            // Τίποτα δεν ήρθε: πιθανό stale keep-alive
+            if (firstLine && hdrLen == 0) {
+                return fail();
+            }
+            close();
+            return SENSOR_HTTP_FAILED;
+        }
+        if (!gotFirstByte) {
+            gotFirstByte = true;
+            latencyMs = millis() - startMs;
+        }
+
+        for (int k = 0; k < rd; ++k) {
+            if (inBody) {
+                // Το υπόλοιπο block είναι body
+                size_t n = (size_t)(rd - k);
+                if (bodyOut && bodyKept + 1 < bodyCap) {
+                    size_t keep = min(n, bodyCap - 1 - bodyKept);
+                    memcpy(bodyOut + bodyKept, buf + k, keep);
+                    bodyKept += keep;
+                    bodyOut[bodyKept] = '\0';
+                }
+                bodyRead += n;
+                break;
+            }
+
+            char c = (char)buf[k];
+            if (c == '\r') continue;
+            if (c != '\n') {
+                if (hdrLen < sizeof(hdr) - 1) hdr[hdrLen++] = c;
+                continue;
+            }
+            hdr[hdrLen] = '\0';
+
+            if (firstLine) {
+                // HTTP/1.1 200 OK
+                const char* sp = strchr(hdr, ' ');
+                status = sp ? atoi(sp + 1) : 0;
+                firstLine = false;
+            } else if (hdrLen == 0) {
+                inBody = true;
+                if (contentLength < 0) peerWillClose = true;
+            } else if (strncasecmp(hdr, "Content-Length:", 15) == 0) {
+                contentLength = atol(hdr + 15);
+            } else if (strncasecmp(hdr, "Connection:", 11) == 0 && strcasestr(hdr + 11, "close")) {
+                peerWillClose = true;
+            }
+            hdrLen = 0;
+        }
+
+        if (inBody && contentLength >= 0 && bodyRead >= contentLength) {
+            inFlight = false;
+            afterResponse();
+            return SENSOR_HTTP_DONE;
+        }
+    }
+}
+
+void SensorHttpClient::afterResponse() {
+    rttMs = millis() - startMs;
+    if (status != 200) {
+        Serial.printf("[SENSOR-HTTP] WARNING: HTTP status %d from %s\n", status, host.c_str());
+    }
+    if (!keepAlive) {
+        close();
+        return;
+    }
+    if (peerWillClose || fd < 0 || peerClosed()) {
+        Serial.printf("[SENSOR-HTTP] %s closes connections, falling back to one connection per request\n",
+                      host.c_str());
+        keepAlive = false;
+        close();
+    }
+}
+
+void SensorHttpClient::close() {
+    inFlight = false;
+    phase = PHASE_IDLE;
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+// ------------------------------------------
+// One-shot requests από το fixed arena
+// ------------------------------------------
+struct SensorHttpSlot {
+    SensorHttpClient client;
+    String path;
+    char body[SENSOR_HTTP_BODY_MAX];
+    SensorHttpCallback cb = nullptr;
+    void* ctx = nullptr;
+    bool used = false;
+};
+
+static SensorHttpSlot g_httpSlots[SENSOR_HTTP_MAX_REQUESTS];
+
+bool shttp_get(const String& ip, const String& pathAndQuery,
+               SensorHttpCallback cb, void* ctx, unsigned long timeoutMs) {
+    SensorHttpSlot* slot = nullptr;
+    for (auto& s : g_httpSlots) {
+        if (!s.used) {
+            slot = &s;
+            break;
+        }
+    }
+    if (!slot) {
+        Serial.printf("[SENSOR-HTTP] WARNING: all %d request slots busy, GET to %s dropped\n",
+                      SENSOR_HTTP_MAX_REQUESTS, ip.c_str());
+        return false;
+    }
+
+    Serial.printf("[SENSOR-HTTP] GET http://%s%s\n", ip.c_str(), pathAndQuery.c_str());
+    slot->path = pathAndQuery;
+    slot->cb = cb;
+    slot->ctx = ctx;
+    slot->client.setHost(ip, false);
+    if (!slot->client.begin(slot->path.c_str(), timeoutMs, slot->body, sizeof(slot->body))) {
+        return false;
+    }
+    slot->used = true;
+    return true;
+}
+
+void shttp_poll() {
+    for (auto& s : g_httpSlots) {
+        if (!s.used) continue;
+        SensorHttpResult r = s.client.poll();
+        if (r == SENSOR_HTTP_PENDING) continue;
+        s.client.close();
+        // Το slot μένει κατειλημμένο μέχρι να επιστρέψει το callback (το body είναι δικό του)
+        if (s.cb) {
+            s.cb(r == SENSOR_HTTP_DONE && s.client.lastOk(), s.client.lastStatus(), s.body, s.ctx);
+        }
+        s.used = false;
+    }
+}
+
+int shttp_inFlight() {
+    int n = 0;
+    for (auto& s : g_httpSlots) {
+        if (s.used) n++;
+    }
+    return n;
+}
+
+void shttp_abortAll() {
+    for (auto& s : g_httpSlots) {
+        if (!s.used) continue;
+        s.used = false;
+        s.client.close();
+    }
+}
+
+bool shttp_statusField(const char* body, const char* key, char* out, size_t cap) {
+    if (!body || cap == 0) return false;
+    size_t keyLen = strlen(key);
+    const char* p = body;
+    while (*p) {
+        while (*p == ' ' || *p == ',' || *p == '\r' || *p == '\n') p++;
+        const char* end = p;
+        while (*end && *end != ',') end++;
+        const char* eq = (const char*)memchr(p, '=', end - p);
+        if (eq) {
+            const char* k = p;
+            const char* kEnd = eq;
+            while (kEnd > k && kEnd[-1] == ' ') kEnd--;
+            if ((size_t)(kEnd - k) == keyLen && strncmp(k, key, keyLen) == 0) {
+                const char* v = eq + 1;
+                const char* vEnd = end;
+                while (v < vEnd && *v == ' ') v++;
+                while (vEnd > v && (vEnd[-1] == ' ' || vEnd[-1] == '\r' || vEnd[-1] == '\n')) vEnd--;
+                size_t n = min((size_t)(vEnd - v), cap - 1);
+                memcpy(out, v, n);
+                out[n] = '\0';
+                return n > 0;
+            }
+        }
+        p = end;
+    }
+    return false;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "config.h"
+#include <Arduino.h>
+
+// Fixed arena για one-shot sensor commands (STATUS, CONFIGURE, ...):
+// SENSOR_HTTP_MAX_REQUESTS ταυτόχρονα requests, το καθένα με body buffer
+// SENSOR_HTTP_BODY_MAX bytes. Μεγαλύτερο body κόβεται (NUL-terminated).
+#define SENSOR_HTTP_MAX_REQUESTS 4
+#define SENSOR_HTTP_BODY_MAX     512
+#define SENSOR_HTTP_CONNECT_MS   3000  // TCP connect προς sensor που δεν απαντά
+
+enum SensorHttpResult {
+    SENSOR_HTTP_PENDING,
+    SENSOR_HTTP_DONE,     // ολόκληρο response (status line + headers + body)
+    SENSOR_HTTP_FAILED
+};
+
+// Non-blocking HTTP/1.1 GET προς sensor (port 80), πάνω σε lwip socket με
+// O_NONBLOCK. begin() ξεκινάει το connect και επιστρέφει αμέσως· poll()
+// προχωράει connect (deadline SENSOR_HTTP_CONNECT_MS), αποστολή του request
+// και ανάγνωση του response, χωρίς ποτέ να περιμένει στο socket.
+// Σε keep-alive mode το connection μένει ανοιχτό και κάθε response διαβάζεται
+// με βάση το Content-Length. Αν ο sensor κλείσει τη σύνδεση (Connection: close /
+// χωρίς Content-Length), πέφτουμε σε ένα connection ανά request.
+class SensorHttpClient {
+public:
+    ~SensorHttpClient() { close(); }
+
+    void setHost(const String& ip, bool keepAlive);
+
+    // Το pathAndQuery πρέπει να μένει valid μέχρι να τελειώσει το request.
+    // Αν δοθεί bodyOut, κρατάμε έως bodyCap-1 bytes του body (NUL-terminated).
+    bool begin(const char* pathAndQuery, unsigned long timeoutMs,
+               char* bodyOut = nullptr, size_t bodyCap = 0);
+    SensorHttpResult poll();
+
+    void close();
+
+    bool busy() const { return inFlight; }
+    bool isKeepAlive() const { return keepAlive; }
+    uint32_t connectCount() const { return connects; }
+    // HTTP status του τελευταίου response (0 αν δεν ήρθε status line).
+    // SENSOR_HTTP_DONE σημαίνει μόνο ολόκληρο response· ο sensor το δέχτηκε
+    // μόνο με 200, οπότε ο caller ελέγχει και το lastOk().
+    int lastStatus() const { return status; }
+    bool lastOk() const { return status == 200; }
+    // Χρόνοι του τελευταίου request: μέχρι το πρώτο byte (latency του sensor)
+    // και μέχρι το τέλος του response (RTT)
+    unsigned long lastLatencyMs() const { return latencyMs; }
+    unsigned long lastRttMs() const { return rttMs; }
+    const String& hostIp() const { return host; }
+
+private:
+    enum Phase : uint8_t { PHASE_IDLE, PHASE_CONNECTING, PHASE_SENDING, PHASE_RECEIVING };
+
+    bool startConnect();
+    bool formatRequest();
+    bool peerClosed();
+    SensorHttpResult pollConnect();
+    SensorHttpResult pollSend();
+    SensorHttpResult pollReceive();
+    void resetParser();
+    void afterResponse();
+    SensorHttpResult fail();
+
+    int fd = -1;
+    Phase phase = PHASE_IDLE;
+    unsigned long connectStartMs = 0;
+    // Request = "GET " + path (του caller, χωρίς αντιγραφή) + reqTail, σε ένα
+    // sendmsg, ώστε το μήκος του path (π.χ. merged CONFIGURE) να μην έχει όριο
+    char reqTail[96];
+    size_t pathLen = 0;
+    size_t tailLen = 0;
+    size_t reqSent = 0;
+    String host;
+    bool keepAlive = true;
+    uint32_t connects = 0;
+
+    // Τρέχον request
+    const char* path = nullptr;
+    char* bodyOut = nullptr;
+    size_t bodyCap = 0;
+    unsigned long startMs = 0;
+    unsigned long timeoutMs = 0;
+    bool inFlight = false;
+    bool reused = false;
+    bool gotFirstByte = false;
+    unsigned long latencyMs = 0;
+    unsigned long rttMs = 0;
+
+    // Incremental response parser
+    char hdr[128];
+    size_t hdrLen = 0;
+    bool inBody = false;
+    bool firstLine = true;
+    long contentLength = -1;
+    long bodyRead = 0;
+    size_t bodyKept = 0;
+    int status = 0;
+    bool peerWillClose = false;
+};
+
+// ------------------------------------------
+// One-shot async requests με callback
+// ------------------------------------------
+// Καλείται από το shttp_poll() (main loop) όταν τελειώσει το request.
+// ok = ολόκληρο response με HTTP 200· status = το HTTP status (0 χωρίς response).
+// Το body ανήκει στο arena και είναι valid μόνο μέσα στο callback.
+typedef void (*SensorHttpCallback)(bool ok, int status, const char* body, void* ctx);
+
+// Ξεκινά GET http://<ip><pathAndQuery> (Connection: close) χωρίς να περιμένει.
+// false αν δεν υπάρχει ελεύθερο slot ή άκυρο request (το cb δεν καλείται)·
+// connect που αποτυγχάνει ή αργεί φτάνει στο cb με ok = false.
+bool shttp_get(const String& ip, const String& pathAndQuery,
+               SensorHttpCallback cb, void* ctx, unsigned long timeoutMs = 5000);
+void shttp_poll();
+int  shttp_inFlight();
+void shttp_abortAll();
+
+// STATUS body: MODE=...,FIRMWARE_VERSION=...,S/N=324269,...
+// Αντιγράφει την τιμή του key (trimmed) στο out.
+bool shttp_statusField(const char* body, const char* key, char* out, size_t cap);
@@ -0,0 +1,103 @@
+#include "sensor_registry.h"
+
+static_assert((SENSOR_REGISTRY_CAPACITY & (SENSOR_REGISTRY_CAPACITY - 1)) == 0,
+              "SENSOR_REGISTRY_CAPACITY must be a power of two");
+static_assert(SENSOR_REGISTRY_MAX_LIVE < SENSOR_REGISTRY_CAPACITY,
+              "registry needs at least one empty slot for probing");
+
+// Αλλάζει με το layout, ώστε ένα firmware με άλλο SensorRecord να μη διαβάσει
+// παλιά RTC δεδομένα
+static const uint32_t SREG_MAGIC = 0x53520000UL ^ (sizeof(SensorRecord) << 8) ^ SENSOR_REGISTRY_CAPACITY;
+
+RTC_DATA_ATTR static uint32_t rtc_sreg_magic = 0;
+RTC_DATA_ATTR static uint32_t rtc_sreg_live = 0;
+RTC_DATA_ATTR static uint32_t rtc_sreg_clock = 0;
+RTC_DATA_ATTR static SensorRecord rtc_sreg[SENSOR_REGISTRY_CAPACITY];
+
+static const uint32_t MASK = SENSOR_REGISTRY_CAPACITY - 1;
+
+static void ensureInit() {
+    if (rtc_sreg_magic == SREG_MAGIC) return;
+    memset(rtc_sreg, 0, sizeof(rtc_sreg));
+    rtc_sreg_live = 0;
+    rtc_sreg_clock = 0;
+    rtc_sreg_magic = SREG_MAGIC;
+}
+
+static inline uint32_t home(uint32_t sn) {
+    uint32_t h = sn * 2654435761UL;
+    return (h ^ (h >> 16)) & MASK;
+}
+
+static int probe(uint32_t sn) {
+    for (uint32_t i = home(sn), n = 0; n < SENSOR_REGISTRY_CAPACITY; i = (i + 1) & MASK, n++) {
+        if (rtc_sreg[i].sn == sn) return (int)i;
+        if (rtc_sreg[i].sn == 0) return -1;
+    }
+    return -1;
+}
+
+// Backward-shift delete: τα επόμενα records του probe chain μετακινούνται
+// πίσω, ώστε να μη χρειάζονται tombstones
+static void eraseAt(uint32_t i) {
+    uint32_t j = i;
+    while (true) {
+        rtc_sreg[i].sn = 0;
+        uint32_t k;
+        do {
+            j = (j + 1) & MASK;
+            if (rtc_sreg[j].sn == 0) return;
+            k = home(rtc_sreg[j].sn);
+        } while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
+        rtc_sreg[i] = rtc_sreg[j];
+        i = j;
+    }
+}
+
+static void evictLru() {
+    int victim = -1;
+    for (uint32_t i = 0; i < SENSOR_REGISTRY_CAPACITY; i++) {
+        if (rtc_sreg[i].sn == 0) continue;
+        if (victim < 0 || (int32_t)(rtc_sreg[i].lastUse - rtc_sreg[victim].lastUse) < 0) victim = (int)i;
+    }
+    if (victim < 0) return;
+    Serial.printf("[SREG] Registry full, evicting SN=%lu\n", (unsigned long)rtc_sreg[victim].sn);
+    eraseAt((uint32_t)victim);
+    rtc_sreg_live--;
+}
+
+bool sreg_parseSn(const char* sn, uint32_t& out) {
+    if (!sn || !*sn) return false;
+    uint64_t v = 0;
+    for (const char* p = sn; *p; p++) {
+        if (*p < '0' || *p > '9') return false;
+        v = v * 10 + (uint32_t)(*p - '0');
+        if (v > 0xFFFFFFFFULL) return false;
+    }
+    if (v == 0) return false;
+    out = (uint32_t)v;
+    return true;
+}
+
+SensorRecord* sreg_touch(uint32_t sn) {
+    ensureInit();
+    if (sn == 0) return nullptr;
+    int i = probe(sn);
+    if (i < 0) {
+        if (rtc_sreg_live >= SENSOR_REGISTRY_MAX_LIVE) evictLru();
+        uint32_t slot = home(sn);
+        while (rtc_sreg[slot].sn != 0) slot = (slot + 1) & MASK;
+        memset(&rtc_sreg[slot], 0, sizeof(SensorRecord));
+        rtc_sreg[slot].sn = sn;
+        rtc_sreg[slot].heartbeatsAfterMeasurement = 1;
+        rtc_sreg_live++;
+        i = (int)slot;
+    }
+    rtc_sreg[i].lastUse = ++rtc_sreg_clock;
+    return &rtc_sreg[i];
+}
+
+uint32_t sreg_size() {
+    ensureInit();
+    return rtc_sreg_live;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "config.h"
+#include <Arduino.h>
+
+// Registry των sensors του collector: SN -> τελευταία IP,
+// heartbeats_after_measurement. Το firmware version κάθε sensor το κρατάει
+// το status log (heartbeat_logger).
+// Open addressing (linear probing) με key το αριθμητικό SN και σταθερή
+// χωρητικότητα, στη RTC slow memory (RTC_DATA_ATTR): επιβιώνει τα timer
+// wakes από deep sleep, οπότε στο επόμενο AP window τα contexts είναι ήδη
+// εκεί. Χωρίς heap. Όταν φτάσει SENSOR_REGISTRY_MAX_LIVE, φεύγει ο sensor με
+// το παλιότερο heartbeat (LRU, scan μόνο τη στιγμή του eviction).
+
+struct SensorRecord {
+    uint32_t sn;               // 0 = κενό slot
+    uint32_t ip;               // IPv4 όπως το (uint32_t)IPAddress
+    uint32_t lastUse;          // LRU stamp
+    int16_t  heartbeatsAfterMeasurement;
+    uint8_t  reserved[2];
+};
+
+// "324269" -> 324269. false για SN που δεν είναι αριθμός 1..2^32-1.
+bool sreg_parseSn(const char* sn, uint32_t& out);
+
+// Find or insert + ενημέρωση LRU. Ένα νέο record έχει heartbeatsAfterMeasurement = 1.
+SensorRecord* sreg_touch(uint32_t sn);
+uint32_t sreg_size();
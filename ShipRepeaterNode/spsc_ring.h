@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free ring ενός producer και ενός consumer (π.χ. AsyncTCP task -> main loop).
+// Ο producer γράφει μόνο το head, ο consumer μόνο το tail. Το release στο
+// store του index και το acquire στο load από την άλλη πλευρά εγγυώνται ότι
+// τα περιεχόμενα του slot είναι ορατά πριν φανεί το index (δύο cores).
+// Όταν γεμίσει, το νέο στοιχείο απορρίπτεται (ο producer δεν αγγίζει το tail)
+// και μετράει στο overflows().
+template <typename T, uint32_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    // Producer: slot για γέμισμα, nullptr αν είναι γεμάτο. Ακολουθεί commitPush().
+    T* beginPush() {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if (h - t >= N) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &items[h & (N - 1)];
+    }
+
+    void commitPush() {
+        uint32_t h = head.load(std::memory_order_relaxed) + 1;
+        uint32_t used = h - tail.load(std::memory_order_relaxed);
+        if (used > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(used, std::memory_order_relaxed);
+        }
+        head.store(h, std::memory_order_release);
+    }
+
+    // Consumer: το παλιότερο στοιχείο, nullptr αν είναι άδειο. Ακολουθεί pop().
+    T* front() {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return nullptr;
+        return &items[t & (N - 1)];
+    }
+
+    void pop() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    static constexpr uint32_t capacity() { return N; }
+    uint32_t overflows() const { return dropped.load(std::memory_order_relaxed); }
+    uint32_t highWatermark() const { return highWater.load(std::memory_order_relaxed); }
+
+private:
+    T items[N];
+    std::atomic<uint32_t> head{0};   // free-running, slot = index & (N - 1)
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<uint32_t> highWater{0};
+};
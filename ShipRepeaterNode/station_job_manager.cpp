@@ -2,6 +2,9 @@
 #include "config.h"
 #include "firmware_updater.h"
 #include "config_updater.h"
+#include "sensor_http.h"
+#include "job_store.h"
+#include "job_sync.h"
 #include <ArduinoJson.h>
 #include <WiFi.h>
 #include <vector>
@@ -19,287 +22,627 @@ static std::vector<PendingStation> g_stations;
 static const char* FW_JOBS_PATH  = "/jobs/firmware_jobs.json";
 static const char* CFG_JOBS_PATH = "/jobs/config_jobs.json";
 
-// Job cache to avoid re-reading JSON on every heartbeat
-static StaticJsonDocument<16384> g_fwJobsCache;
-static StaticJsonDocument<16384> g_cfgJobsCache;
-static bool g_fwJobsCached = false;
-static bool g_cfgJobsCached = false;
+// Job index to avoid re-reading JSON on every heartbeat (σταθερή RAM,
+// τα records φορτώνονται από την SD μόνο όταν χρειάζονται)
+static JobStore g_fwJobs;
+static JobStore g_cfgJobs;
 static unsigned long g_lastJobLoadTime = 0;
 
+// Ένα job record τη φορά (main loop μόνο) + τα συγχωνευμένα CONFIG params
+static StaticJsonDocument<JOB_RECORD_DOC_SIZE> g_jobDoc;
+static StaticJsonDocument<JOB_RECORD_DOC_SIZE> g_mergedParams;
+
 // ---------------------
-// Helper για SD + JSON
+// Job index: streaming scan μία φορά ανά AP session
 // ---------------------
-static bool readJsonFile(const char* path, StaticJsonDocument<16384>& doc) {
-    if (!initSdCard()) return false;
-    if (!sd.exists(path)) return false;
-    FsFile f = sd.open(path, O_RDONLY);
-    if (!f) return false;
-
-    DeserializationError err = deserializeJson(doc, f);
-    f.close();
-    if (err) {
-        Serial.printf("[JOBS] JSON parse error in %s: %s\n", path, err.c_str());
-        return false;
-    }
-    return true;
+static void loadJobCaches() {
+    if (g_lastJobLoadTime != 0) return;
+    g_fwJobs.load(FW_JOBS_PATH);   // false => No FW jobs
+    g_cfgJobs.load(CFG_JOBS_PATH); // false => No config jobs
+    // Mark that we've attempted to load jobs (set after both attempts)
+    g_lastJobLoadTime = millis();
 }
 
-static bool writeJsonFile(const char* path, StaticJsonDocument<16384>& doc) {
-    if (!initSdCard()) return false;
-    FsFile f = sd.open(path, O_WRONLY | O_CREAT | O_TRUNC);
-    if (!f) {
-        Serial.printf("[JOBS] Cannot open %s for writing\n", path);
-        return false;
+// ---------------------
+// Job slots: έως MAX_PARALLEL_SENSOR_JOBS sensors ταυτόχρονα.
+// Κάθε slot είναι ένα non-blocking FW ή CONFIG transfer. Το main loop τα
+// ξεκινά (φόρτωση job από SD) και μαζεύει τα αποτελέσματα, το job task τα
+// προχωράει (και κατεβάζει από τον root το .hex που λείπει). Ένα slot που τρέχει αλλάζει μόνο με το slot lock· το SD bus
+// lock παίρνεται μέσα του, μόνο γύρω από τις κλήσεις SD/NVS.
+// Sensors χωρίς ελεύθερο slot περιμένουν σε μικρή FIFO.
+// ---------------------
+enum JobSlotKind { SLOT_FREE, SLOT_FW, SLOT_CFG };
+
+// Το πολύ τόσα jobs ενός SN σε ένα slot (CONFIG: συγχωνεύονται), τα υπόλοιπα
+// στο επόμενο heartbeat
+static const int SLOT_MAX_JOBS = 16;
+
+struct JobSlot {
+    JobSlotKind kind = SLOT_FREE;
+    String sn;
+    int jobCount = 0;   // jobs του JSON που καλύπτει (CONFIG: merged)
+    uint32_t jobIds[SLOT_MAX_JOBS];  // ids (JobIdHasher) όσων στάλθηκαν: μόνο αυτά ολοκληρώνονται
+    uint32_t gen = 0;   // αυξάνει σε κάθε start, αγνοούμε παλιά αποτελέσματα
+    bool reported = false;
+    bool fetchHex = false;  // COLLECTOR: το .hex λείπει, το task το κατεβάζει και κάνει begin(fwJob)
+    unsigned long startMs = 0;
+    FirmwareJob fwJob;
+    FirmwareTransfer fw;
+    ConfigTransfer cfg;
+};
+
+// Job task -> main loop
+struct SensorJobResult {
+    uint8_t slot;
+    uint32_t gen;
+    bool ok;
+};
+
+struct WaitingSensor {
+    String sn;
+    String ip;
+};
+
+static JobSlot g_slots[MAX_PARALLEL_SENSOR_JOBS];
+static std::vector<WaitingSensor> g_waiting;
+static TaskHandle_t g_jobTask = nullptr;
+static QueueHandle_t g_jobResults = nullptr;
+static SemaphoreHandle_t g_slotLock = nullptr;
+
+static bool slotLock(uint32_t timeoutMs) {
+    if (!g_slotLock) return true;  // χωρίς task
+    return xSemaphoreTake(g_slotLock, timeoutMs == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+static void slotUnlock() {
+    if (g_slotLock) xSemaphoreGive(g_slotLock);
+}
+
+// Record στο g_jobDoc + το id του, για να ολοκληρωθεί ακριβώς αυτό το job
+static bool loadJobRecord(JobStore& store, char kind, int idx, const String& sn, uint32_t& idOut) {
+    SdBusGuard sdBus;
+    if (!store.loadJob(idx, sn, g_jobDoc)) return false;
+    idOut = store.recordId(idx, kind);
+    return idOut != 0;
+}
+
+static JobSlot* findSlot(const String& sn) {
+    for (auto& s : g_slots) {
+        if (s.kind != SLOT_FREE && s.sn == sn) return &s;
     }
-    if (serializeJson(doc, f) == 0) {
-        Serial.printf("[JOBS] Failed to serialize JSON to %s\n", path);
-        f.close();
-        return false;
+    return nullptr;
+}
+
+static JobSlot* freeSlot() {
+    for (auto& s : g_slots) {
+        if (s.kind == SLOT_FREE) return &s;
     }
-    f.close();
-    return true;
+    return nullptr;
+}
+
+static bool hasJobForSN(const String& sn) {
+    SdBusGuard sdBus;
+    return g_fwJobs.has(sn, g_jobDoc) || g_cfgJobs.has(sn, g_jobDoc);
 }
 
 // ---------------------
-// STATUS request:
-//   - GET /api?command=STATUS&datetime=<ms>&
-//   - Παίρνουμε S/N από το body
+// Job task: προχωράει τα slots ώστε ένα firmware update λεπτών να μην
+// κρατάει το main loop (heartbeats, AP timeout, LED). Έχει δικό του
+// watchdog subscription και ξυπνά με notify όταν ξεκινά job.
 // ---------------------
-bool sjm_requestStatus(const String& ip, String& snOut) {
-    if (ip.length() == 0 || ip == "0.0.0.0") return false;
 
-    // Wait 2s πριν το STATUS, όπως ο daemon
-    delay(2000);
+// Ένα βήμα σε κάθε slot που τρέχει. Γυρίζει πόσα τρέχουν ακόμα.
+// Καλείται με το slot lock. Τα transfers δεν μπλοκάρουν στο network και
+// παίρνουν το SD bus lock μόνα τους (blocks του .hex, checkpoint, stats).
+static int pollSlots() {
+    int active = 0;
+    for (int i = 0; i < MAX_PARALLEL_SENSOR_JOBS; ++i) {
+        JobSlot& slot = g_slots[i];
+        if (slot.kind == SLOT_FREE || slot.reported) continue;
+        if (slot.fetchHex) {
+            active++;
+            continue;
+        }
+        bool done;
+        bool ok;
+        if (slot.kind == SLOT_FW) {
+            slot.fw.poll();
+            done = slot.fw.finished();
+            ok = slot.fw.succeeded();
+        } else {
+            done = slot.cfg.poll();
+            ok = slot.cfg.succeeded();
+        }
+        if (!done) {
+            active++;
+            continue;
+        }
+        slot.reported = true;
+        SensorJobResult r = { (uint8_t)i, slot.gen, ok };
+        xQueueSend(g_jobResults, &r, 0);
+    }
+    return active;
+}
 
-    WiFiClient client;
-    unsigned long epochMs = millis();
-    String path = "/api?command=STATUS&datetime=" + String(epochMs) + "&";
+// Το .hex ενός FW slot λείπει: download από τον root χωρίς το slot lock
+// (blocking network I/O, καθυστερεί μόνο τα άλλα slots), μετά begin().
+// Ένα slot ανά κλήση. Με cancel/abort στο μεταξύ το αποτέλεσμα αγνοείται.
+extern bool downloadFileFromRoot(const String& remotePath, const String& localPath);
+
+static void fetchPendingHex() {
+    int i;
+    slotLock(portMAX_DELAY);
+    for (i = 0; i < MAX_PARALLEL_SENSOR_JOBS; ++i) {
+        const JobSlot& s = g_slots[i];
+        if (s.kind == SLOT_FW && s.fetchHex && !s.reported) break;
+    }
+    if (i == MAX_PARALLEL_SENSOR_JOBS) {
+        slotUnlock();
+        return;
+    }
+    JobSlot& slot = g_slots[i];
+    uint32_t gen = slot.gen;
+    String hexPath = slot.fwJob.hexPath;
+    slotUnlock();
+
+    // Σε .part και rename, ώστε άλλο slot να μη στείλει μισό image.
+    // Αν το κατέβασε ήδη άλλο slot, δεν ξανακατεβαίνει.
+    bool ok;
+    {
+        SdBusGuard sdBus;
+        ok = sd.exists(hexPath.c_str());
+    }
+    if (!ok) {
+        String part = hexPath + ".part";
+        Serial.printf("[JOBS] Firmware file not found, downloading from root: %s\n", hexPath.c_str());
+        ok = downloadFileFromRoot(hexPath, part);
+        SdBusGuard sdBus;
+        if (ok) {
+            ok = sd.rename(part.c_str(), hexPath.c_str());
+        } else {
+            sd.remove(part.c_str());
+        }
+        if (ok) {
+            Serial.printf("[JOBS] Firmware file downloaded successfully\n");
+        } else {
+            Serial.printf("[JOBS] FAIL: Cannot download firmware file %s\n", hexPath.c_str());
+        }
+    }
 
-    String request =
-        String("GET ") + path + " HTTP/1.1\r\n" +
-        "Host: " + ip + "\r\n" +
-        "Connection: close\r\n\r\n";
+    slotLock(portMAX_DELAY);
+    if (slot.kind == SLOT_FW && slot.gen == gen && slot.fetchHex) {
+        slot.fetchHex = false;
+        if (!ok || !slot.fw.begin(slot.fwJob)) {
+            slot.reported = true;
+            SensorJobResult r = { (uint8_t)i, gen, false };
+            xQueueSend(g_jobResults, &r, 0);
+        }
+    }
+    slotUnlock();
+}
 
-    Serial.printf("[STATUS] HTTP GET http://%s%s\n", ip.c_str(), path.c_str());
+static void jobTaskMain(void*) {
+    esp_task_wdt_add(NULL);
+    for (;;) {
+        esp_task_wdt_reset();
+        fetchPendingHex();
+        int active = 0;
+        if (slotLock(1000)) {
+            active = pollSlots();
+            slotUnlock();
+        }
+        if (active > 0) {
+            vTaskDelay(1);
+        } else {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+        }
+    }
+}
 
-    if (!client.connect(ip.c_str(), 80)) {
-        Serial.println("[STATUS] ERROR: connect() failed");
-        return false;
+static void ensureJobTask() {
+    if (!g_jobResults) {
+        g_jobResults = xQueueCreate(MAX_PARALLEL_SENSOR_JOBS, sizeof(SensorJobResult));
+    }
+    if (!g_slotLock) g_slotLock = xSemaphoreCreateMutex();
+    if (g_jobTask || !g_jobResults || !g_slotLock) return;
+    if (xTaskCreatePinnedToCore(jobTaskMain, "sensor_jobs", SENSOR_JOB_TASK_STACK, nullptr, 1,
+                                &g_jobTask, ARDUINO_RUNNING_CORE) != pdPASS) {
+        // Χωρίς task τα slots προχωράνε από το sjm_pollJobs()
+        Serial.println("[JOBS] WARNING: cannot start job task, polling from main loop");
+        g_jobTask = nullptr;
     }
+}
+
+// Το transfer έχει ήδη begin() (ή fetchHex: το begin μετά το download):
+// από εδώ και πέρα το slot το προχωράει το task
+// Τα jobIds/jobCount/fwJob τα έχει ήδη γεμίσει ο caller (το slot ήταν ελεύθερο)
+static void slotStarted(JobSlot& slot, JobSlotKind kind, const String& sn, bool fetchHex = false) {
+    ensureJobTask();
+    slotLock(portMAX_DELAY);
+    slot.sn = sn;
+    slot.gen++;
+    slot.reported = false;
+    slot.fetchHex = fetchHex;
+    slot.startMs = millis();
+    slot.kind = kind;
+    slotUnlock();
+    if (g_jobTask) xTaskNotifyGive(g_jobTask);
+}
 
-    client.print(request);
+// Ξεκινά το job του SN στο slot
+// Προτεραιότητα: FW πρώτα, μετά CONFIG
+static bool startJobInSlot(JobSlot& slot, const String& sn, const String& ip) {
+    // 1) Firmware jobs (προτεραιότητα)
+    int idx[SLOT_MAX_JOBS];
+    int n = g_fwJobs.candidates(sn, idx, SLOT_MAX_JOBS);
+    for (int k = 0; k < n; ++k) {
+        uint32_t id;
+        if (loadJobRecord(g_fwJobs, 'f', idx[k], sn, id)) {
+            JsonObject jobObj = g_jobDoc.as<JsonObject>();
+            FirmwareJob fw;
+            fw.sensorSN  = sn;
+            fw.sensorIp  = ip;
+            fw.hexPath   = jobObj["hex_path"] | String("/firmware/default.hex");
+            fw.maxLines  = jobObj["max_lines"] | 0;
+            fw.totalTimeoutMs = jobObj["timeout_ms"] | (8UL * 60UL * 1000UL);
+            fw.keepAlive = jobObj["keep_alive"] | true;
+
+            Serial.printf("[JOBS] Found FW job for SN=%s\n", sn.c_str());
+
+            slot.jobIds[0] = id;
+            slot.jobCount = 1;
+
+            // For COLLECTOR: το .hex που λείπει το κατεβάζει το job task, όχι το main loop
+            extern NodeConfig config;
+            if (config.role == ROLE_COLLECTOR) {
+                bool haveHex;
+                {
+                    SdBusGuard sdBus;
+                    haveHex = sd.exists(fw.hexPath.c_str());
+                }
+                if (!haveHex) {
+                    slot.fwJob = fw;
+                    slotStarted(slot, SLOT_FW, sn, true);
+                    return true;
+                }
+            }
+
+            if (!slot.fw.begin(fw)) {
+                Serial.printf("[JOBS] FW job result for SN=%s -> FAIL\n", sn.c_str());
+                return false;
+            }
+            slotStarted(slot, SLOT_FW, sn);
+            // Αν υπήρχε FW job, δεν κάνουμε CONFIG στο ίδιο window
+            return true;
+        }
+    }
 
-    unsigned long start = millis();
-    String response;
-    while (millis() - start < 5000UL) {
-        while (client.available()) {
-            char c = client.read();
-            response += c;
+    // 2) Configuration jobs
+    {
+        // Όλα τα CONFIG jobs του SN γίνονται ένα request: τα params
+        // συγχωνεύονται με τη σειρά του αρχείου (το τελευταίο κερδίζει ανά key)
+        g_mergedParams.clear();
+        JsonObject params = g_mergedParams.to<JsonObject>();
+        int count = 0;
+        n = g_cfgJobs.candidates(sn, idx, SLOT_MAX_JOBS);
+        for (int k = 0; k < n; ++k) {
+            uint32_t id;
+            if (!loadJobRecord(g_cfgJobs, 'c', idx[k], sn, id)) continue;
+            for (JsonPair kv : g_jobDoc["params"].as<JsonObject>()) {
+                params[String(kv.key().c_str())] = kv.value();
+            }
+            slot.jobIds[count++] = id;
+        }
+        if (count > 0) {
+            if (g_mergedParams.overflowed()) {
+                Serial.printf("[JOBS] WARNING: CONFIG params for SN=%s too large to merge\n", sn.c_str());
+                return false;
+            }
+            ConfigJob cfg;
+            cfg.sensorSn = sn;
+            cfg.sensorIp = ip;
+            cfg.params   = params;
+
+            Serial.printf("[JOBS] Found %d CONFIG job(s) for SN=%s (%d params)\n",
+                          count, sn.c_str(), (int)params.size());
+            if (!slot.cfg.begin(cfg)) {
+                Serial.printf("[JOBS] CONFIG job result for SN=%s -> FAIL\n", sn.c_str());
+                return false;
+            }
+            slot.jobCount = count;
+            slotStarted(slot, SLOT_CFG, sn);
+            return true;
         }
-        if (!client.connected()) break;
-        delay(1);
     }
-    client.stop();
+    return false;
+}
 
-    int headerEnd = response.indexOf("\r\n\r\n");
-    String body = (headerEnd >= 0) ? response.substring(headerEnd + 4) : response;
+// Βρίσκουμε jobs για συγκεκριμένο SN και τα ξεκινάμε (δεν περιμένουμε να τελειώσουν).
+// Γυρίζει true αν το SN έχει job που τρέχει ή περιμένει slot.
+// ---------------------
+bool processJobsForSN(const String& sn, const String& ip) {
+    {
+        SdBusGuard sdBus;
+        loadJobCaches();
+    }
 
-    if (body.length() == 0) {
-        Serial.println("[STATUS] WARNING: empty body");
+    if (findSlot(sn)) {
+        Serial.printf("[JOBS] Job already running for SN=%s\n", sn.c_str());
+        return true;
+    }
+    if (!hasJobForSN(sn)) {
         return false;
     }
 
-    // status body: MODE=...,FIRMWARE_VERSION=...,S/N=324269,...
-    snOut = "";
-    int pos = 0;
-    while (true) {
-        int comma = body.indexOf(',', pos);
-        String part = (comma < 0) ? body.substring(pos) : body.substring(pos, comma);
-        int eq = part.indexOf('=');
-        if (eq > 0) {
-            String key = part.substring(0, eq);
-            String val = part.substring(eq + 1);
-            key.trim();
-            val.trim();
-            if (key == "S/N") {
-                snOut = val;
-                break;
+    JobSlot* slot = freeSlot();
+    if (!slot) {
+        for (auto& w : g_waiting) {
+            if (w.sn == sn) {
+                w.ip = ip;
+                return true;
             }
         }
-        if (comma < 0) break;
-        pos = comma + 1;
+        if (g_waiting.size() >= SENSOR_JOB_QUEUE_SIZE) {
+            Serial.printf("[JOBS] WARNING: job queue full, SN=%s will retry on next heartbeat\n", sn.c_str());
+            return false;
+        }
+        WaitingSensor w;
+        w.sn = sn;
+        w.ip = ip;
+        g_waiting.push_back(w);
+        Serial.printf("[JOBS] All %d job slots busy, SN=%s queued (%d waiting)\n",
+                      MAX_PARALLEL_SENSOR_JOBS, sn.c_str(), (int)g_waiting.size());
+        return true;
     }
+    return startJobInSlot(*slot, sn, ip);
+}
 
-    if (snOut.length() == 0) {
-        Serial.println("[STATUS] WARNING: S/N not found in body");
-        return false;
+// Tombstone τοπικά + outbox για τον root (το επόμενο sync το ανεβάζει).
+// Ακριβώς τα ids που στάλθηκαν: αν το αρχείο άλλαξε ενδιάμεσα (sync, compact,
+// νέο αρχείο), ένα άλλο job του SN δεν σημειώνεται κατά λάθος ως done.
+static void completeJobs(JobStore& store, char kind, const JobSlot& slot) {
+    SdBusGuard sdBus;
+    loadJobCaches();  // μετά από sjm_resetJobCache()
+    int removed = 0;
+    for (int i = 0; i < slot.jobCount; ++i) {
+        if (store.removeById(slot.sn, kind, slot.jobIds[i])) removed++;
     }
+    if (removed < slot.jobCount) {
+        Serial.printf("[JOBS] %d of %d jobs for SN=%s no longer in the job file\n",
+                      slot.jobCount - removed, slot.jobCount, slot.sn.c_str());
+    }
+    // Στάλθηκαν στον sensor: ο root τα μαθαίνει ακόμα κι αν το τοπικό αρχείο άλλαξε
+    jsync_recordCompletion(kind, slot.sn, slot.jobIds, slot.jobCount);
+}
 
-    Serial.printf("[STATUS] SN=%s for IP=%s\n", snOut.c_str(), ip.c_str());
-    return true;
+static void releaseSlot(JobSlot& slot) {
+    slot.kind = SLOT_FREE;
+    slot.sn = "";
+    slot.reported = false;
+    slot.fetchHex = false;
 }
 
-// ---------------------
-// Helper: Get jobs array from JSON document
-// Supports both {"jobs": [...]} and [...] formats
-static JsonArray getJobsArray(JsonDocument& doc) {
-    // Try {"jobs": [...]} format first
-    JsonArray arr = doc["jobs"].as<JsonArray>();
-    if (!arr.isNull()) {
-        return arr;
+// Αποτελέσματα από το job task + sensors που περίμεναν slot (main loop)
+void sjm_pollJobs() {
+    if (!g_jobTask && g_jobResults) fetchPendingHex();
+    slotLock(portMAX_DELAY);
+    if (!g_jobTask && g_jobResults) pollSlots();
+
+    SensorJobResult r;
+    while (g_jobResults && xQueueReceive(g_jobResults, &r, 0) == pdTRUE) {
+        JobSlot& slot = g_slots[r.slot];
+        if (slot.kind == SLOT_FREE || slot.gen != r.gen) continue;  // ακυρώθηκε ενδιάμεσα
+        if (slot.kind == SLOT_FW) {
+            Serial.printf("[JOBS] FW job result for SN=%s -> %s\n",
+                          slot.sn.c_str(), r.ok ? "OK" : "FAIL");
+            // Only remove job on success
+            if (r.ok) completeJobs(g_fwJobs, 'f', slot);
+        } else {
+            Serial.printf("[JOBS] CONFIG job result for SN=%s -> %s\n",
+                          slot.sn.c_str(), r.ok ? "OK" : "FAIL");
+            if (r.ok) completeJobs(g_cfgJobs, 'c', slot);
+        }
+        releaseSlot(slot);
+    }
+    slotUnlock();
+
+    // Sensors που περίμεναν slot. Τα ελεύθερα slots και η FIFO είναι μόνο
+    // του main loop, οπότε το start (SD) γίνεται χωρίς lock.
+    while (!g_waiting.empty()) {
+        JobSlot* slot = freeSlot();
+        if (!slot) break;
+        WaitingSensor w = g_waiting.front();
+        g_waiting.erase(g_waiting.begin());
+        startJobInSlot(*slot, w.sn, w.ip);
     }
-    // Try root array format [...]
-    arr = doc.as<JsonArray>();
-    return arr;
 }
 
-// Βρίσκουμε jobs για συγκεκριμένο SN
-// Προτεραιότητα: FW πρώτα, μετά CONFIG
-// ---------------------
-bool processJobsForSN(const String& sn, const String& ip) {
-    bool didSomething = false;
+int sjm_jobsActive() {
+    int n = 0;
+    for (auto& slot : g_slots) {
+        if (slot.kind != SLOT_FREE) n++;
+    }
+    return n + (int)g_waiting.size();
+}
 
-    // Load jobs into cache if not already loaded (only once per AP session)
-    if (!g_fwJobsCached && g_lastJobLoadTime == 0) {
-        g_fwJobsCached = readJsonFile(FW_JOBS_PATH, g_fwJobsCache);
-        if (!g_fwJobsCached) {
-            g_fwJobsCache.clear(); // No FW jobs
-        }
+int sjm_jobProgress(SensorJobProgress* out, int maxOut) {
+    int n = 0;
+    slotLock(portMAX_DELAY);
+    for (auto& slot : g_slots) {
+        if (slot.kind == SLOT_FREE || n >= maxOut) continue;
+        SensorJobProgress& p = out[n++];
+        strncpy(p.sn, slot.sn.c_str(), sizeof(p.sn) - 1);
+        p.sn[sizeof(p.sn) - 1] = '\0';
+        p.kind = slot.kind == SLOT_FW ? 'f' : 'c';
+        p.records = slot.kind == SLOT_FW && !slot.fetchHex ? slot.fw.recordsSent() : 0;
+        p.elapsedMs = millis() - slot.startMs;
+        p.waiting = false;
     }
-    if (!g_cfgJobsCached && g_lastJobLoadTime == 0) {
-        g_cfgJobsCached = readJsonFile(CFG_JOBS_PATH, g_cfgJobsCache);
-        if (!g_cfgJobsCached) {
-            g_cfgJobsCache.clear(); // No config jobs
-        }
+    for (auto& w : g_waiting) {
+        if (n >= maxOut) break;
+        SensorJobProgress& p = out[n++];
+        strncpy(p.sn, w.sn.c_str(), sizeof(p.sn) - 1);
+        p.sn[sizeof(p.sn) - 1] = '\0';
+        p.kind = 0;
+        p.records = 0;
+        p.elapsedMs = 0;
+        p.waiting = true;
     }
-    // Mark that we've attempted to load jobs (set after both attempts)
-    if (g_lastJobLoadTime == 0) {
-        g_lastJobLoadTime = millis();
+    slotUnlock();
+    return n;
+}
+
+// Με το slot lock το task δεν είναι μέσα σε poll, οπότε το abort γίνεται εδώ.
+// Τα FW jobs κρατούν checkpoint και συνεχίζουν στο επόμενο window.
+static void abortSlot(JobSlot& slot) {
+    if (!slot.reported && !slot.fetchHex) {
+        if (slot.kind == SLOT_FW) slot.fw.abort();
+        else if (slot.kind == SLOT_CFG) slot.cfg.abort();
     }
+    releaseSlot(slot);
+}
 
-    // 1) Firmware jobs (προτεραιότητα)
-    if (g_fwJobsCached) {
-        StaticJsonDocument<16384>& doc = g_fwJobsCache;
-        JsonArray arr = getJobsArray(doc);
-            if (!arr.isNull()) {
-                for (size_t i = 0; i < arr.size(); ++i) {
-                    JsonObject jobObj = arr[i];
-                    String jobSn = jobObj["sn"].as<String>();
-                    if (jobSn == sn) {
-                        FirmwareJob fw;
-                        fw.sensorSN  = sn;
-                        fw.sensorIp  = ip;
-                        fw.hexPath   = jobObj["hex_path"] | String("/firmware/default.hex");
-                        fw.maxLines  = jobObj["max_lines"] | 0;
-                        fw.totalTimeoutMs = jobObj["timeout_ms"] | (8UL * 60UL * 1000UL);
-
-                        Serial.printf("[JOBS] Found FW job for SN=%s\n", sn.c_str());
-                        
-                        // For COLLECTOR: ensure firmware file is downloaded from root
-                        extern NodeConfig config;
-                        extern bool downloadFileFromRoot(const String& remotePath, const String& localPath);
-                        if (config.role == ROLE_COLLECTOR) {
-                            if (!sd.exists(fw.hexPath.c_str())) {
-                                Serial.printf("[JOBS] Firmware file not found, downloading from root: %s\n", fw.hexPath.c_str());
-                                bool downloaded = downloadFileFromRoot(fw.hexPath, fw.hexPath);
-                                if (!downloaded) {
-                                    Serial.printf("[JOBS] FAIL: Cannot download firmware file %s\n", fw.hexPath.c_str());
-                                    return false;
-                                }
-                                Serial.printf("[JOBS] Firmware file downloaded successfully\n");
-                            }
-                        }
-                        
-                        bool ok = executeFirmwareJob(fw);
-                        Serial.printf("[JOBS] FW job result for SN=%s -> %s\n",
-                                      sn.c_str(), ok ? "OK" : "FAIL");
-
-                        // Only remove job on success
-                        if (ok) {
-                            arr.remove(i);
-                            if (arr.size() == 0) {
-                                sd.remove(FW_JOBS_PATH);
-                                g_fwJobsCached = false;
-                                g_fwJobsCache.clear();
-                            } else {
-                                writeJsonFile(FW_JOBS_PATH, doc);
-                            }
-                        }
-                        didSomething = ok;
-
-                        // Αν υπήρχε FW job, δεν κάνουμε CONFIG στο ίδιο window
-                        return didSomething;
-                    }
-                }
-            }
+bool sjm_cancelJob(const String& sn) {
+    bool found = false;
+    slotLock(portMAX_DELAY);
+    for (auto& slot : g_slots) {
+        if (slot.kind != SLOT_FREE && slot.sn == sn) {
+            Serial.printf("[JOBS] Cancelling job for SN=%s\n", sn.c_str());
+            abortSlot(slot);
+            found = true;
         }
-
-    // 2) Configuration jobs
-    if (g_cfgJobsCached) {
-        StaticJsonDocument<16384>& doc = g_cfgJobsCache;
-        JsonArray arr = getJobsArray(doc);
-            if (!arr.isNull()) {
-                for (size_t i = 0; i < arr.size(); ++i) {
-                    JsonObject jobObj = arr[i];
-                    String jobSn = jobObj["sn"].as<String>();
-                    if (jobSn == sn) {
-                        JsonObject params = jobObj["params"].as<JsonObject>();
-
-                        ConfigJob cfg;
-                        cfg.sensorSn = sn;
-                        cfg.sensorIp = ip;
-                        cfg.params   = params;
-
-                        Serial.printf("[JOBS] Found CONFIG job for SN=%s\n", sn.c_str());
-                        bool ok = cu_sendConfiguration(cfg);
-                        Serial.printf("[JOBS] CONFIG job result for SN=%s -> %s\n",
-                                      sn.c_str(), ok ? "OK" : "FAIL");
-
-                        // Only remove job on success
-                        if (ok) {
-                            arr.remove(i);
-                            if (arr.size() == 0) {
-                                sd.remove(CFG_JOBS_PATH);
-                                g_cfgJobsCached = false;
-                                g_cfgJobsCache.clear();
-                            } else {
-                                writeJsonFile(CFG_JOBS_PATH, doc);
-                            }
-                        }
-                        didSomething = ok;
-                        break;
-                    }
-                }
-            }
+    }
+    for (size_t i = 0; i < g_waiting.size(); ++i) {
+        if (g_waiting[i].sn == sn) {
+            g_waiting.erase(g_waiting.begin() + i);
+            found = true;
+            break;
         }
+    }
+    slotUnlock();
+    return found;
+}
+
+// Σταματάει ό,τι τρέχει (π.χ. κλείνει το AP)
+void sjm_abortJobs() {
+    slotLock(portMAX_DELAY);
+    for (auto& slot : g_slots) {
+        if (slot.kind != SLOT_FREE) abortSlot(slot);
+    }
+    g_waiting.clear();
+    SensorJobResult r;
+    while (g_jobResults && xQueueReceive(g_jobResults, &r, 0) == pdTRUE) {}
+    slotUnlock();
+}
 
-    return didSomething;
+// Compaction των job files: ξαναγράφονται χωρίς τα ολοκληρωμένα jobs.
+// Στο τέλος του AP window ή όταν δεν τρέχει τίποτα.
+void sjm_compactJobs(bool force) {
+    if (sjm_jobsActive() > 0) return;
+    if (g_fwJobs.pendingTombstones() == 0 && g_cfgJobs.pendingTombstones() == 0) return;
+    // Αν αποτύχει (π.χ. SD), όχι ξανά σε κάθε loop
+    static unsigned long lastTry = 0;
+    if (!force && lastTry != 0 && millis() - lastTry < JOB_COMPACT_IDLE_MS) return;
+    lastTry = millis();
+    SdBusGuard sdBus;
+    g_fwJobs.compact();
+    g_cfgJobs.compact();
 }
 
 // Reset job cache (call when AP session starts)
 void sjm_resetJobCache() {
-    g_fwJobsCached = false;
-    g_cfgJobsCached = false;
-    g_fwJobsCache.clear();
-    g_cfgJobsCache.clear();
+    g_fwJobs.clear();
+    g_cfgJobs.clear();
     g_lastJobLoadTime = 0;
     Serial.println("[JOBS] Cache reset");
 }
 
+JobStore& sjm_jobStore(char kind) {
+    return kind == 'f' ? g_fwJobs : g_cfgJobs;
+}
+
 // Alias for compatibility
 void resetJobCache() {
     sjm_resetJobCache();
 }
 
 // ---------------------
-// IP resolution
+// Πίνακας stations του AP: MAC (6 bytes) -> IP.
+// Γεμίζει από τα WiFi events (connect / DHCP lease / disconnect), οπότε το
+// main loop βρίσκει την IP με ένα lookup, χωρίς sta lists και Strings.
+// Events και main loop είναι σε διαφορετικά tasks: όλα με το g_stationMux.
 // ---------------------
 extern "C" {
 #include "esp_wifi.h"
 #include "tcpip_adapter.h"
 }
+#include "esp_idf_version.h"
+
+#define STATION_TABLE_SIZE 16   // δύναμη του 2, > μέγιστες stations του softAP (10)
+
+enum StationSlotState : uint8_t { STA_EMPTY, STA_USED, STA_DELETED };
+
+struct StationEntry {
+    uint8_t mac[6];
+    StationSlotState state;
+    bool fresh;         // νέα σύνδεση που δεν έχει δει ακόμα το main loop
+    uint32_t ip;        // lwIP byte order, 0 = χωρίς lease
+};
+
+static StationEntry g_table[STATION_TABLE_SIZE];
+static bool g_leasesDirty = false;   // IDF < 5.1: το lease event δεν έχει MAC
+static portMUX_TYPE g_stationMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t macHash(const uint8_t* mac) {
+    uint32_t h = 2166136261UL;
+    for (int i = 0; i < 6; ++i) {
+        h ^= mac[i];
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+// Linear probing. Καλείται με το g_stationMux.
+static StationEntry* tableFind(const uint8_t* mac, bool insert) {
+    uint32_t i = macHash(mac) & (STATION_TABLE_SIZE - 1);
+    StationEntry* freeEntry = nullptr;
+    for (int n = 0; n < STATION_TABLE_SIZE; ++n, i = (i + 1) & (STATION_TABLE_SIZE - 1)) {
+        StationEntry& e = g_table[i];
+        if (e.state == STA_EMPTY) {
+            if (!freeEntry) freeEntry = &e;
+            break;
+        }
+        if (e.state == STA_DELETED) {
+            if (!freeEntry) freeEntry = &e;
+            continue;
+        }
+        if (memcmp(e.mac, mac, 6) == 0) return &e;
+    }
+    if (!insert || !freeEntry) return nullptr;
+    memcpy(freeEntry->mac, mac, 6);
+    freeEntry->state = STA_USED;
+    freeEntry->fresh = false;
+    freeEntry->ip = 0;
+    return freeEntry;
+}
+
+static uint32_t stationIp(const uint8_t* mac) {
+    portENTER_CRITICAL(&g_stationMux);
+    StationEntry* e = tableFind(mac, false);
+    uint32_t ip = e ? e->ip : 0;
+    portEXIT_CRITICAL(&g_stationMux);
+    return ip;
+}
+
+// Μόνο για logs
+static const char* macToStr(const uint8_t* mac, char* buf, size_t len) {
+    snprintf(buf, len, "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return buf;
+}
 
-static void updateStationIPs() {
+// Χωρίς MAC στο lease event: ένα διάβασμα των DHCP leases ανά event
+static void refreshLeases() {
     wifi_sta_list_t wifi_sta_list;
     tcpip_adapter_sta_list_t adapter_sta_list;
     memset(&wifi_sta_list, 0, sizeof(wifi_sta_list));
@@ -312,40 +655,43 @@ static void updateStationIPs() {
         return;
     }
 
-    for (auto& st : g_stations) {
-        // Αν έχουμε ήδη κανονική IP (όχι 0.0.0.0), δεν χρειάζεται update
-        if (st.ip.length() > 0 && st.ip != "0.0.0.0") continue;
-
-        for (int j = 0; j < adapter_sta_list.num; ++j) {
-            const wifi_sta_info_t& wi = wifi_sta_list.sta[j];
-            const tcpip_adapter_sta_info_t& ai = adapter_sta_list.sta[j];
-
-            char macStr[20];
-            sprintf(macStr, "%02x:%02x:%02x:%02x:%02x:%02x",
-                    wi.mac[0], wi.mac[1], wi.mac[2],
-                    wi.mac[3], wi.mac[4], wi.mac[5]);
+    portENTER_CRITICAL(&g_stationMux);
+    for (int j = 0; j < adapter_sta_list.num; ++j) {
+        const tcpip_adapter_sta_info_t& ai = adapter_sta_list.sta[j];
+        // DHCP δεν έχει δώσει IP ακόμα, μην γράψεις 0.0.0.0
+        if (ai.ip.addr == 0) continue;
+        StationEntry* e = tableFind(ai.mac, true);
+        if (e) e->ip = ai.ip.addr;
+    }
+    portEXIT_CRITICAL(&g_stationMux);
+}
 
-            if (!st.mac.equalsIgnoreCase(String(macStr))) continue;
+void sjm_stationConnected(const uint8_t mac[6]) {
+    portENTER_CRITICAL(&g_stationMux);
+    StationEntry* e = tableFind(mac, true);
+    if (e) {
+        e->ip = 0;  // νέο lease
+        e->fresh = true;
+    }
+    portEXIT_CRITICAL(&g_stationMux);
+}
 
-            uint32_t ipraw = ai.ip.addr;
-            if (ipraw == 0) {
-                // DHCP δεν έχει δώσει IP ακόμα, μην γράψεις 0.0.0.0
-                continue;
-            }
+void sjm_stationDisconnected(const uint8_t mac[6]) {
+    portENTER_CRITICAL(&g_stationMux);
+    StationEntry* e = tableFind(mac, false);
+    if (e) e->state = STA_DELETED;
+    portEXIT_CRITICAL(&g_stationMux);
+}
 
-            IPAddress ipAddr(
-                ipraw & 0xFF,
-                (ipraw >> 8) & 0xFF,
-                (ipraw >> 16) & 0xFF,
-                (ipraw >> 24) & 0xFF
-            );
-            String ipStr = ipAddr.toString();
-
-            st.ip = ipStr;
-            Serial.printf("[SJM] MAC %s -> IP %s\n",
-                          st.mac.c_str(), st.ip.c_str());
-        }
-    }
+void sjm_stationIpAssigned(const WiFiEventInfo_t& info) {
+    portENTER_CRITICAL(&g_stationMux);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+    StationEntry* e = tableFind(info.wifi_ap_staipassigned.mac, true);
+    if (e) e->ip = info.wifi_ap_staipassigned.ip.addr;
+#else
+    g_leasesDirty = true;
+#endif
+    portEXIT_CRITICAL(&g_stationMux);
 }
 
 // ---------------------
@@ -353,77 +699,142 @@ static void updateStationIPs() {
 // ---------------------
 void sjm_init() {
     g_stations.clear();
+    portENTER_CRITICAL(&g_stationMux);
+    for (auto& e : g_table) e.state = STA_EMPTY;
+    g_leasesDirty = false;
+    portEXIT_CRITICAL(&g_stationMux);
     Serial.println("[SJM] init()");
 }
 
-void sjm_addStation(const String& mac) {
+void sjm_addStation(const uint8_t mac[6]) {
+    uint32_t now = millis();
+    char macStr[20];
     // Αν υπάρχει ήδη station με την ίδια MAC, κάνε update, μην δημιουργείς διπλό
     for (auto& st : g_stations) {
-        if (st.mac.equalsIgnoreCase(mac)) {
-            st.connectedAtMillis = millis();
-            st.ip = "";  // θα την ξαναβρούμε
-            Serial.printf("[SJM] Station refreshed: %s\n", mac.c_str());
+        if (memcmp(st.mac, mac, 6) == 0) {
+            st.connectedAtMillis = now;
+            st.notBefore = now + STATION_STATUS_GRACE_MS;
+            st.ip = 0;  // θα την ξαναβρούμε
+            st.tries = 0;
+            st.done = false;
+            Serial.printf("[SJM] Station refreshed: %s\n", macToStr(mac, macStr, sizeof(macStr)));
             return;
         }
     }
 
+    static uint32_t nextId = 1;
     PendingStation st;
-    st.mac = mac;
-    st.ip  = "";
-    st.connectedAtMillis = millis();
+    memcpy(st.mac, mac, 6);
+    st.connectedAtMillis = now;
+    st.notBefore = now + STATION_STATUS_GRACE_MS;
+    st.id = nextId++;
     g_stations.push_back(st);
-    Serial.printf("[SJM] New station added: %s\n", mac.c_str());
+    Serial.printf("[SJM] New station added: %s (STATUS in %u ms)\n",
+                  macToStr(mac, macStr, sizeof(macStr)), STATION_STATUS_GRACE_MS);
 }
 
-void sjm_processStations() {
-    if (g_stations.empty()) return;
+// Αποτυχία STATUS: ξανά αργότερα (1 s, 2 s, ...) ή τέλος
+static void retryStatus(PendingStation& st, uint32_t now) {
+    char macStr[20];
+    macToStr(st.mac, macStr, sizeof(macStr));
+    String ip = IPAddress(st.ip).toString();
+    if (++st.tries >= STATION_STATUS_TRIES) {
+        Serial.printf("[SJM] STATUS failed for MAC=%s IP=%s, giving up\n", macStr, ip.c_str());
+        st.done = true;
+        return;
+    }
+    st.notBefore = now + (1000UL << (st.tries - 1));
+    Serial.printf("[SJM] STATUS failed for MAC=%s IP=%s, retry in %lu ms\n",
+                  macStr, ip.c_str(), (unsigned long)(st.notBefore - now));
+}
 
-    // Προσπαθούμε να συμπληρώσουμε IPs από MAC list
-    updateStationIPs();
+// STATUS απάντηση (από shttp_poll): S/N -> jobs
+static void onStationStatus(bool ok, int status, const char* body, void* ctx) {
+    uint32_t id = (uint32_t)(uintptr_t)ctx;
+    PendingStation* st = nullptr;
+    for (auto& s : g_stations) {
+        if (s.id == id) {
+            st = &s;
+            break;
+        }
+    }
+    if (!st) return;  // η station αφαιρέθηκε στο μεταξύ
+    st->statusInFlight = false;
 
-    unsigned long now = millis();
-    std::vector<String> toRemove;
+    char sn[32];
+    if (!ok || !shttp_statusField(body, "S/N", sn, sizeof(sn))) {
+        retryStatus(*st, millis());
+        return;
+    }
+    st->done = true;
+    String ip = IPAddress(st->ip).toString();
+    Serial.printf("[STATUS] SN=%s for IP=%s\n", sn, ip.c_str());
+
+    bool didJobs = processJobsForSN(String(sn), ip);
+    if (didJobs) {
+        Serial.printf("[SJM] Jobs scheduled for SN=%s (IP=%s)\n", sn, ip.c_str());
+    } else {
+        Serial.printf("[SJM] No jobs for SN=%s (IP=%s)\n", sn, ip.c_str());
+    }
+}
 
-    for (auto& st : g_stations) {
-        // Περιμένουμε τουλάχιστον 2s μετά το connect
-        if (now - st.connectedAtMillis < 2000UL) continue;
+void sjm_processStations() {
+    // Νέες συνδέσεις από τα events
+    uint8_t fresh[STATION_TABLE_SIZE][6];
+    int n = 0;
+    bool dirty;
+    portENTER_CRITICAL(&g_stationMux);
+    for (auto& e : g_table) {
+        if (e.state != STA_USED || !e.fresh) continue;
+        memcpy(fresh[n++], e.mac, 6);
+        e.fresh = false;
+    }
+    dirty = g_leasesDirty;
+    g_leasesDirty = false;
+    portEXIT_CRITICAL(&g_stationMux);
 
-        // Αν δεν έχουμε έγκυρη IP, μην προσπαθήσεις STATUS
-        if (st.ip.length() == 0 || st.ip == "0.0.0.0") continue;
+    for (int i = 0; i < n; ++i) {
+        sjm_addStation(fresh[i]);
+    }
+    if (dirty) refreshLeases();
 
-        String sn;
-        if (!sjm_requestStatus(st.ip, sn)) {
-            Serial.printf("[SJM] STATUS failed for MAC=%s IP=%s\n",
-                          st.mac.c_str(), st.ip.c_str());
-            toRemove.push_back(st.mac);
+    if (g_stations.empty()) return;
+
+    uint32_t now = millis();
+    for (auto& st : g_stations) {
+        if (st.done || st.statusInFlight) continue;
+        if ((int32_t)(now - st.notBefore) < 0) continue;
+
+        // Χωρίς IP ακόμα (DHCP): ξανακοιτάμε σε λίγο
+        if (st.ip == 0) st.ip = stationIp(st.mac);
+        if (st.ip == 0) {
+            if (now - st.connectedAtMillis > STATION_IP_WAIT_MS) {
+                char macStr[20];
+                Serial.printf("[SJM] No IP for MAC=%s, giving up\n", macToStr(st.mac, macStr, sizeof(macStr)));
+                st.done = true;
+            } else {
+                st.notBefore = now + 500;
+            }
             continue;
         }
 
-        bool didJobs = processJobsForSN(sn, st.ip);
-        if (didJobs) {
-            Serial.printf("[SJM] Jobs processed for SN=%s (IP=%s)\n",
-                          sn.c_str(), st.ip.c_str());
+        // Όλα τα request slots πιασμένα: μένει due για το επόμενο loop
+        if (shttp_inFlight() >= SENSOR_HTTP_MAX_REQUESTS) break;
+
+        // STATUS χωρίς αναμονή, η απάντηση έρχεται στο onStationStatus
+        String path = "/api?command=STATUS&datetime=" + String(now) + "&";
+        if (shttp_get(IPAddress(st.ip).toString(), path, onStationStatus, (void*)(uintptr_t)st.id)) {
+            st.statusInFlight = true;
         } else {
-            Serial.printf("[SJM] No jobs for SN=%s (IP=%s)\n",
-                          sn.c_str(), st.ip.c_str());
+            retryStatus(st, now);
         }
-
-        // Μία φορά ανά σύνδεση
-        toRemove.push_back(st.mac);
     }
 
-    if (!toRemove.empty()) {
-        g_stations.erase(
-            std::remove_if(
-                g_stations.begin(),
-                g_stations.end(),
-                [&](const PendingStation& st) {
-                    for (auto& mac : toRemove) {
-                        if (st.mac.equalsIgnoreCase(mac)) return true;
-                    }
-                    return false;
-                }),
-            g_stations.end()
-        );
-    }
+    g_stations.erase(
+        std::remove_if(
+            g_stations.begin(),
+            g_stations.end(),
+            [](const PendingStation& st) { return st.done; }),
+        g_stations.end()
+    );
 }
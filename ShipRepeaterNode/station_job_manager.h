@@ -6,18 +6,52 @@
 #include <vector>
 #include <algorithm>
 
+// STATUS μετά το connect: όχι νωρίτερα από STATION_STATUS_GRACE_MS (ο sensor
+// ετοιμάζει το HTTP server του), retries με backoff, χωρίς delay στο loop
+#define STATION_STATUS_GRACE_MS   2000
+#define STATION_STATUS_TRIES      3
+#define STATION_IP_WAIT_MS        30000  // χωρίς DHCP lease τόσο => αγνοείται
+
 struct PendingStation {
-    String mac;
-    String ip;
+    uint8_t mac[6];
+    uint32_t ip = 0;              // από τον πίνακα stations (DHCP events), 0 = όχι ακόμα
     uint32_t connectedAtMillis;
+    uint32_t notBefore = 0;       // millis(): το STATUS δεν γίνεται πριν από αυτό
+    uint32_t id = 0;              // για το STATUS callback (το vector μπορεί να μετακινηθεί)
+    uint8_t tries = 0;
+    bool statusInFlight = false;
+    bool done = false;            // μία φορά ανά σύνδεση
 };
 
 void sjm_init();
-void sjm_addStation(const String& mac);
-void sjm_processStations();
+void sjm_addStation(const uint8_t mac[6]);
+// WiFi events (άλλο task): ενημερώνουν τον πίνακα MAC -> IP
+void sjm_stationConnected(const uint8_t mac[6]);
+void sjm_stationDisconnected(const uint8_t mac[6]);
+void sjm_stationIpAssigned(const WiFiEventInfo_t& info);
+void sjm_processStations();   // main loop: STATUS στις stations που έγιναν due
 void sjm_resetJobCache();  // Reset job cache when AP session starts
 void resetJobCache();      // Alias for sjm_resetJobCache for compatibility
 
 // Helper functions for async heartbeat-driven job execution
-bool sjm_requestStatus(const String& ip, String& snOut);
 bool processJobsForSN(const String& sn, const String& ip);
+
+// Parallel job execution (MAX_PARALLEL_SENSOR_JOBS slots, driven by the "sensor_jobs" task)
+struct SensorJobProgress {
+    char sn[24];
+    char kind;            // 'f' = firmware, 'c' = config, 0 = περιμένει slot
+    uint32_t records;     // FW: records με ack
+    uint32_t elapsedMs;
+    bool waiting;
+};
+
+void sjm_pollJobs();      // call from main loop: results + waiting sensors
+int  sjm_jobsActive();    // running + waiting jobs
+int  sjm_jobProgress(SensorJobProgress* out, int maxOut);
+bool sjm_cancelJob(const String& sn);
+void sjm_abortJobs();     // on AP stop
+void sjm_compactJobs(bool force = false); // drop completed jobs from the job files (idle / AP stop)
+
+// Τα job indexes (f = firmware, c = config) για το sync με τον root
+class JobStore;
+JobStore& sjm_jobStore(char kind);
@@ -0,0 +1,72 @@
+#pragma once
+
+// Μορφή του /received/status.bin (heartbeat/status log του collector).
+// Κοινό header με το host εργαλείο tools/status_log_dump.cpp, γι' αυτό μόνο
+// <stdint.h>. Όλα little-endian (ESP32 και x86/ARM hosts).
+//
+//   [StatusLogHeader]                                  32 bytes
+//   [StatusLogSensor  x maxSensors]                    32 bytes το καθένα
+//   [StatusLogRecord  x maxSensors x slotsPerSensor]   32 bytes το καθένα
+//
+// Το αρχείο δημιουργείται μία φορά σε πλήρες μέγεθος και μετά γράφεται μόνο
+// in place: κάθε sensor (SN interned στον πίνακα) έχει δικό του ring από
+// slotsPerSensor records, οπότε το μέγεθος μένει σταθερό.
+//
+// Record i (0 = παλιότερο) του sensor s:
+//   slot = (count - min(count, slotsPerSensor) + i) % slotsPerSensor
+// Records με seq < firstSeq ανήκουν σε sensor που έγινε evict από το ίδιο index.
+
+#include <stdint.h>
+
+#define STATUS_LOG_MAGIC   0x314C5253UL   // "SRL1"
+#define STATUS_LOG_VERSION 1
+
+struct StatusLogHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;       // sizeof(StatusLogRecord)
+    uint16_t slotsPerSensor;
+    uint16_t maxSensors;
+    uint32_t seq;              // τελευταίο seq που δόθηκε (αύξον σε όλο το αρχείο)
+    uint8_t  reserved[16];
+};
+
+struct StatusLogSensor {
+    char     sn[20];           // "" = ελεύθερο
+    uint32_t count;            // records που γράφτηκαν συνολικά (free-running)
+    uint32_t firstSeq;         // seq του πρώτου record αυτού του SN
+    uint32_t lastSeq;          // για eviction του λιγότερο πρόσφατου
+};
+
+enum StatusLogKind : uint8_t {
+    STATUS_LOG_HEARTBEAT = 1,  // /event/heartbeat
+    STATUS_LOG_STATUS    = 2,  // /api/status με STATUS body
+};
+
+enum StatusLogFlags : uint8_t {
+    STATUS_LOG_TIME_VALID  = 0x01,  // epoch από συγχρονισμένο ρολόι
+    STATUS_LOG_HAS_BATTERY = 0x02,
+    STATUS_LOG_HAS_FW      = 0x04,
+    STATUS_LOG_HAS_WIFI    = 0x08,
+    STATUS_LOG_HAS_TEMP    = 0x10,
+    STATUS_LOG_BOOTLOADER  = 0x20,  // FIRMWARE_VERSION=BL_...
+};
+
+struct StatusLogRecord {
+    uint32_t seq;              // 0 = κενό slot
+    uint32_t epoch;            // UTC, έγκυρο μόνο με STATUS_LOG_TIME_VALID
+    uint32_t uptimeMs;         // millis() του collector
+    uint16_t sensor;           // index στον πίνακα sensors
+    uint8_t  kind;             // StatusLogKind
+    uint8_t  flags;            // StatusLogFlags
+    uint8_t  ip[4];
+    uint32_t firmware;         // major << 16 | minor << 8 | patch
+    uint16_t batteryMv;        // BATTERY_VOLTAGE
+    int16_t  wifiSignal;       // WIFI_SIGNAL όπως το στέλνει ο sensor
+    int16_t  tempDeciC;        // TEMPERATURE σε 0.1 °C
+    uint8_t  reserved[2];
+};
+
+static_assert(sizeof(StatusLogHeader) == 32, "StatusLogHeader layout");
+static_assert(sizeof(StatusLogSensor) == 32, "StatusLogSensor layout");
+static_assert(sizeof(StatusLogRecord) == 32, "StatusLogRecord layout");
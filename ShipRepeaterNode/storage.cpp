@@ -109,6 +109,15 @@ time_t restoreRtcTime() {
 }
 
 
+bool sdBusLock(uint32_t timeoutMs) {
+  if (!sdBusMutex) return true;  // πριν το setup / config mode
+  return xSemaphoreTakeRecursive(sdBusMutex, timeoutMs == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+void sdBusUnlock() {
+  if (sdBusMutex) xSemaphoreGiveRecursive(sdBusMutex);
+}
+
 bool initSdCard() {
   if (xSemaphoreTake(sdCardMutex, pdMS_TO_TICKS(500)) == pdFALSE)
     return false;
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Sensor stand-in for benchmarking firmware transfer from a collector.
+
+Run it on a PC joined to the collector's sensor AP. It posts one heartbeat
+with heartbeats_after_measurement > 1 (so the collector checks jobs for SN),
+then answers /api?command=... like a Diagnonic sensor on port 80 and reports
+FIRMWARE_UPDATE lines per second.
+
+Put a firmware job for the same SN in /jobs/firmware_jobs.json on the
+collector's SD card, e.g.:
+
+    sudo ./sensor_standin.py --sn 999001
+    sudo ./sensor_standin.py --sn 999001 --close        # per-line fallback
+    sudo ./sensor_standin.py --sn 999001 --latency-ms 5 # slow flash writes
+"""
+
+import argparse
+import json
+import sys
+import threading
+import time
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlparse, parse_qs
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.lines = 0
+        self.bad = 0
+        self.connections = set()
+        self.first = None
+        self.last = None
+
+    def line(self, conn_id, ok):
+        with self.lock:
+            now = time.monotonic()
+            if self.first is None:
+                self.first = now
+            self.last = now
+            self.lines += 1
+            if not ok:
+                self.bad += 1
+            self.connections.add(conn_id)
+            return self.lines
+
+    def summary(self):
+        with self.lock:
+            if self.first is None:
+                return "no FIRMWARE_UPDATE lines received"
+            dur = max(self.last - self.first, 1e-6)
+            return (f"{self.lines} lines in {dur:.1f} s = {self.lines / dur:.1f} lines/s, "
+                    f"{len(self.connections)} TCP connections, {self.bad} bad checksums")
+
+
+def hex_record_ok(payload):
+    # payload is the record with ':' already replaced by '.'
+    if not payload.startswith(".") or len(payload) < 11 or (len(payload) - 1) % 2:
+        return False
+    try:
+        data = bytes.fromhex(payload[1:])
+    except ValueError:
+        return False
+    return len(data) == data[0] + 5 and sum(data) & 0xFF == 0
+
+
+def make_handler(args, stats):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.0" if args.close else "HTTP/1.1"
+
+        def log_message(self, fmt, *a):
+            if args.verbose:
+                sys.stderr.write("%s - %s\n" % (self.address_string(), fmt % a))
+
+        def reply(self, body):
+            data = body.encode()
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain")
+            if args.close:
+                self.send_header("Connection", "close")
+            else:
+                self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+
+        def do_GET(self):
+            q = parse_qs(urlparse(self.path).query, keep_blank_values=True)
+            cmd = q.get("command", [""])[0]
+            if cmd == "FIRMWARE_UPDATE":
+                if args.latency_ms:
+                    time.sleep(args.latency_ms / 1000.0)
+                ok = hex_record_ok(q.get("hex", [""])[0])
+                n = stats.line(self.client_address, ok)
+                if n % args.report_every == 0:
+                    print("[STANDIN] " + stats.summary(), flush=True)
+                self.reply("OK" if ok else "ERROR")
+            elif cmd == "STATUS":
+                self.reply(f"MODE=BOOTLOADER,FIRMWARE_VERSION=0.0,S/N={args.sn},BATTERY=100")
+            else:
+                self.reply("OK")
+
+    return Handler
+
+
+def send_heartbeat(args):
+    body = json.dumps({"sensor_sn": args.sn, "heartbeats_after_measurement": 2}).encode()
+    req = urllib.request.Request(f"http://{args.collector}:3000/event/heartbeat", data=body,
+                                 headers={"Content-Type": "application/json"})
+    try:
+        with urllib.request.urlopen(req, timeout=5) as r:
+            print(f"[STANDIN] heartbeat -> {r.status} {r.read().decode()}", flush=True)
+    except Exception as e:
+        print(f"[STANDIN] heartbeat failed: {e}", flush=True)
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("--sn", default="999001", help="serial number to report")
+    p.add_argument("--collector", default="192.168.4.1", help="collector AP address")
+    p.add_argument("--port", type=int, default=80)
+    p.add_argument("--close", action="store_true", help="close the connection after every response")
+    p.add_argument("--latency-ms", type=float, default=0.0, help="extra delay per FIRMWARE_UPDATE line")
+    p.add_argument("--report-every", type=int, default=200)
+    p.add_argument("--no-heartbeat", action="store_true")
+    p.add_argument("--verbose", action="store_true")
+    args = p.parse_args()
+
+    stats = Stats()
+    srv = ThreadingHTTPServer(("0.0.0.0", args.port), make_handler(args, stats))
+    threading.Thread(target=srv.serve_forever, daemon=True).start()
+    print(f"[STANDIN] listening on :{args.port} ({'close' if args.close else 'keep-alive'})", flush=True)
+
+    if not args.no_heartbeat:
+        send_heartbeat(args)
+
+    try:
+        while True:
+            time.sleep(1)
+    except KeyboardInterrupt:
+        pass
+    srv.shutdown()
+    print("[STANDIN] " + stats.summary())
+
+
+if __name__ == "__main__":
+    main()
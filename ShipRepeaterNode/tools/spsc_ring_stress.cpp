@@ -0,0 +1,209 @@
+// Stress test του SpscRing (spsc_ring.h) στον host: ένα producer και ένα
+// consumer thread, όπως AsyncTCP task -> main loop στο ESP32.
+//
+//   g++ -std=c++17 -O2 -pthread -o spsc_ring_stress spsc_ring_stress.cpp
+//   ./spsc_ring_stress [items]
+//
+// Με -fsanitize=thread πιάνει και data races στα slots. Ελέγχει:
+//   1. κάτω από το capacity (ο producer περιμένει χώρο): κανένα drop,
+//      όλα τα στοιχεία φτάνουν με τη σειρά και ακέραια
+//   2. γεμάτο ring χωρίς consumer: δέχεται ακριβώς N, τα υπόλοιπα μετράνε
+//      στο overflows(), το drain δίνει τα πρώτα N με τη σειρά
+//   3. producer χωρίς αναμονή με consumer που αργεί: ό,τι φτάνει είναι
+//      αύξουσα υπακολουθία, ελήφθησαν + overflows() == στάλθηκαν και το
+//      overflows() ίσο με τα nullptr που είδε ο producer
+
+#include "../spsc_ring.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+static const uint32_t RING_SIZE = 16;   // όπως το hbBuffer
+static const int PAYLOAD_WORDS = 15;
+
+struct Item {
+    uint32_t seq;
+    uint32_t payload[PAYLOAD_WORDS];  // σκισμένο slot => λάθος checksum
+};
+
+typedef SpscRing<Item, RING_SIZE> Ring;
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                      \
+    do {                                                      \
+        if (!(cond)) {                                        \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                     \
+            fprintf(stderr, "\n");                            \
+            failures++;                                       \
+        }                                                     \
+    } while (0)
+
+static void fill(Item& it, uint32_t seq) {
+    it.seq = seq;
+    for (int i = 0; i < PAYLOAD_WORDS; ++i) it.payload[i] = seq * 2654435761u + (uint32_t)i;
+}
+
+static bool intact(const Item& it) {
+    for (int i = 0; i < PAYLOAD_WORDS; ++i) {
+        if (it.payload[i] != it.seq * 2654435761u + (uint32_t)i) return false;
+    }
+    return true;
+}
+
+// 1. Ο producer δεν ξεπερνά ποτέ το capacity
+static void testNoLoss(uint32_t items) {
+    static Ring ring;
+    uint32_t producerNulls = 0;
+
+    std::thread producer([&] {
+        for (uint32_t seq = 0; seq < items; ++seq) {
+            while (ring.size() >= Ring::capacity()) std::this_thread::yield();
+            Item* slot = ring.beginPush();
+            if (!slot) {
+                producerNulls++;
+                continue;
+            }
+            fill(*slot, seq);
+            ring.commitPush();
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t torn = 0;
+    while (expected < items) {
+        Item* it = ring.front();
+        if (!it) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (it->seq != expected) {
+            CHECK(false, "no-loss: got seq %u, expected %u", (unsigned)it->seq, (unsigned)expected);
+            break;
+        }
+        if (!intact(*it)) torn++;
+        ring.pop();
+        expected++;
+    }
+    producer.join();
+
+    CHECK(producerNulls == 0, "no-loss: producer saw %u full rings", (unsigned)producerNulls);
+    CHECK(ring.overflows() == 0, "no-loss: %u overflows", (unsigned)ring.overflows());
+    CHECK(torn == 0, "no-loss: %u torn items", (unsigned)torn);
+    CHECK(ring.size() == 0, "no-loss: %u items left", (unsigned)ring.size());
+    CHECK(ring.highWatermark() <= Ring::capacity(), "no-loss: high watermark %u",
+          (unsigned)ring.highWatermark());
+    printf("no-loss:   %u items in order, high watermark %u/%u\n", (unsigned)expected,
+           (unsigned)ring.highWatermark(), (unsigned)Ring::capacity());
+}
+
+// 2. Χωρίς consumer: ακριβώς N μέσα, τα υπόλοιπα overflows
+static void testFull() {
+    static Ring ring;
+    const uint32_t pushes = Ring::capacity() * 3 + 5;
+
+    std::thread producer([&] {
+        for (uint32_t seq = 0; seq < pushes; ++seq) {
+            Item* slot = ring.beginPush();
+            if (!slot) continue;
+            fill(*slot, seq);
+            ring.commitPush();
+        }
+    });
+    producer.join();
+
+    CHECK(ring.size() == Ring::capacity(), "full: size %u", (unsigned)ring.size());
+    CHECK(ring.overflows() == pushes - Ring::capacity(), "full: %u overflows, expected %u",
+          (unsigned)ring.overflows(), (unsigned)(pushes - Ring::capacity()));
+    CHECK(ring.highWatermark() == Ring::capacity(), "full: high watermark %u",
+          (unsigned)ring.highWatermark());
+
+    uint32_t expected = 0;
+    std::thread consumer([&] {
+        Item* it;
+        while ((it = ring.front()) != nullptr) {
+            CHECK(it->seq == expected && intact(*it), "full: drained seq %u, expected %u",
+                  (unsigned)it->seq, (unsigned)expected);
+            ring.pop();
+            expected++;
+        }
+    });
+    consumer.join();
+    CHECK(expected == Ring::capacity(), "full: drained %u", (unsigned)expected);
+    printf("full:      %u accepted, %u overflows\n", (unsigned)expected, (unsigned)ring.overflows());
+}
+
+// 3. Producer χωρίς αναμονή, consumer που αργεί: drops, αλλά σωστά μετρημένα
+static void testOverflow(uint32_t items) {
+    static Ring ring;
+    uint32_t producerNulls = 0;
+    bool producerDone = false;
+    std::atomic<bool> done{false};
+
+    std::thread producer([&] {
+        for (uint32_t seq = 0; seq < items; ++seq) {
+            Item* slot = ring.beginPush();
+            if (!slot) {
+                // Το στοιχείο χάθηκε· δίνουμε CPU στον consumer, αλλιώς σε
+                // ένα core ο producer τελειώνει πριν ξυπνήσει
+                producerNulls++;
+                std::this_thread::yield();
+                continue;
+            }
+            fill(*slot, seq);
+            ring.commitPush();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    uint32_t received = 0;
+    uint32_t torn = 0;
+    int64_t last = -1;
+    for (;;) {
+        Item* it = ring.front();
+        if (!it) {
+            if (producerDone) break;
+            producerDone = done.load(std::memory_order_acquire);
+            continue;
+        }
+        if ((int64_t)it->seq <= last) {
+            CHECK(false, "overflow: seq %u after %lld", (unsigned)it->seq, (long long)last);
+        }
+        if (!intact(*it)) torn++;
+        last = it->seq;
+        ring.pop();
+        received++;
+        // Ο consumer αργεί κάθε τόσο ώστε το ring να γεμίζει
+        if ((received & 63) == 0) std::this_thread::yield();
+    }
+    producer.join();
+
+    CHECK(received + ring.overflows() == items, "overflow: %u received + %u overflows != %u",
+          (unsigned)received, (unsigned)ring.overflows(), (unsigned)items);
+    CHECK(ring.overflows() == producerNulls, "overflow: %u overflows, producer saw %u",
+          (unsigned)ring.overflows(), (unsigned)producerNulls);
+    CHECK(torn == 0, "overflow: %u torn items", (unsigned)torn);
+    CHECK(ring.highWatermark() <= Ring::capacity(), "overflow: high watermark %u",
+          (unsigned)ring.highWatermark());
+    printf("overflow:  %u received, %u overflows, high watermark %u/%u\n", (unsigned)received,
+           (unsigned)ring.overflows(), (unsigned)ring.highWatermark(), (unsigned)Ring::capacity());
+}
+
+int main(int argc, char** argv) {
+    uint32_t items = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 2000000;
+    if (items == 0) {
+        fprintf(stderr, "usage: %s [items]\n", argv[0]);
+        return 2;
+    }
+    testNoLoss(items);
+    testFull();
+    testOverflow(items);
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
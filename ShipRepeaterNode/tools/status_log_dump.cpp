@@ -0,0 +1,130 @@
+// Dump του /received/status.bin (heartbeat/status log του collector) σε CSV.
+//
+//   g++ -std=c++11 -O2 -o status_log_dump status_log_dump.cpp
+//   ./status_log_dump status.bin > status.csv
+//   ./status_log_dump status.bin --sn 324269
+//
+// Μία γραμμή ανά record, με σειρά seq (χρονολογική σε όλους τους sensors):
+// seq,time,uptime_ms,sn,ip,kind,battery_v,firmware,wifi_signal,temperature_c
+// Τα πεδία που δεν έστειλε ο sensor μένουν κενά.
+
+#include "../status_log_format.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+struct Row {
+    StatusLogRecord rec;
+    const StatusLogSensor* sensor;
+};
+
+static bool readAll(FILE* f, void* dst, size_t n) {
+    return fread(dst, 1, n, f) == n;
+}
+
+static void printRow(const Row& r) {
+    const StatusLogRecord& rec = r.rec;
+    char when[32] = "";
+    if (rec.flags & STATUS_LOG_TIME_VALID) {
+        time_t t = (time_t)rec.epoch;
+        struct tm tmv;
+        gmtime_r(&t, &tmv);
+        strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", &tmv);
+    }
+    char sn[sizeof(r.sensor->sn) + 1];
+    memcpy(sn, r.sensor->sn, sizeof(r.sensor->sn));
+    sn[sizeof(r.sensor->sn)] = '\0';
+
+    printf("%u,%s,%u,%s,%u.%u.%u.%u,%s,", (unsigned)rec.seq, when, (unsigned)rec.uptimeMs, sn,
+           rec.ip[0], rec.ip[1], rec.ip[2], rec.ip[3],
+           rec.kind == STATUS_LOG_STATUS ? "status" : "heartbeat");
+    if (rec.flags & STATUS_LOG_HAS_BATTERY) printf("%.3f", rec.batteryMv / 1000.0);
+    printf(",");
+    if (rec.flags & STATUS_LOG_HAS_FW) {
+        printf("%s%u.%u.%u", (rec.flags & STATUS_LOG_BOOTLOADER) ? "BL_" : "",
+               (unsigned)(rec.firmware >> 16), (unsigned)((rec.firmware >> 8) & 0xFF),
+               (unsigned)(rec.firmware & 0xFF));
+    }
+    printf(",");
+    if (rec.flags & STATUS_LOG_HAS_WIFI) printf("%d", rec.wifiSignal);
+    printf(",");
+    if (rec.flags & STATUS_LOG_HAS_TEMP) printf("%.1f", rec.tempDeciC / 10.0);
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    std::string onlySn;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sn") == 0 && i + 1 < argc) {
+            onlySn = argv[++i];
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s status.bin [--sn SN]\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    StatusLogHeader h;
+    if (!readAll(f, &h, sizeof(h)) || h.magic != STATUS_LOG_MAGIC) {
+        fprintf(stderr, "%s: not a status log\n", path);
+        fclose(f);
+        return 1;
+    }
+    if (h.version != STATUS_LOG_VERSION || h.recordSize != sizeof(StatusLogRecord) ||
+        h.slotsPerSensor == 0) {
+        fprintf(stderr, "%s: unsupported format (version %u, record %u bytes)\n", path,
+                (unsigned)h.version, (unsigned)h.recordSize);
+        fclose(f);
+        return 1;
+    }
+
+    std::vector<StatusLogSensor> sensors(h.maxSensors);
+    std::vector<StatusLogRecord> ring(h.slotsPerSensor);
+    if (!sensors.empty() && !readAll(f, sensors.data(), sensors.size() * sizeof(StatusLogSensor))) {
+        fprintf(stderr, "%s: truncated sensor table\n", path);
+        fclose(f);
+        return 1;
+    }
+
+    std::vector<Row> rows;
+    for (uint16_t i = 0; i < h.maxSensors; i++) {
+        const StatusLogSensor& s = sensors[i];
+        if (s.sn[0] == '\0') continue;
+        if (!onlySn.empty() && strncmp(s.sn, onlySn.c_str(), sizeof(s.sn)) != 0) continue;
+
+        long off = (long)sizeof(StatusLogHeader) + (long)h.maxSensors * sizeof(StatusLogSensor) +
+                   (long)i * h.slotsPerSensor * sizeof(StatusLogRecord);
+        if (fseek(f, off, SEEK_SET) != 0 || !readAll(f, ring.data(), ring.size() * sizeof(StatusLogRecord))) {
+            fprintf(stderr, "%s: truncated records for SN %.20s\n", path, s.sn);
+            continue;
+        }
+        uint32_t n = std::min<uint32_t>(s.count, h.slotsPerSensor);
+        for (uint32_t k = 0; k < n; k++) {
+            const StatusLogRecord& rec = ring[(s.count - n + k) % h.slotsPerSensor];
+            // Κενό slot ή record προηγούμενου SN στο ίδιο index (eviction)
+            if (rec.seq == 0 || rec.seq < s.firstSeq || rec.sensor != i) continue;
+            rows.push_back(Row{rec, &s});
+        }
+    }
+    fclose(f);
+
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.rec.seq < b.rec.seq; });
+    printf("seq,time,uptime_ms,sn,ip,kind,battery_v,firmware,wifi_signal,temperature_c\n");
+    for (const Row& r : rows) printRow(r);
+    return 0;
+}